@@ -0,0 +1,120 @@
+/*
+  HostSim.h - simulation HAL of the low power sensor node
+
+  The host build replaces ArduinoCore by a HAL that keeps a simulated clock
+  and charges the current of every state the node can be in:
+
+  - the MCU itself (active, idle, ADC noise reduction, power-down)
+  - loads switched by a pin (transmitter, sensor, LED), see hostSimAttachLoad
+  - the EEPROM programming time
+
+  Timer1 (normal and CTC mode, compare A interrupt) and sleep_cpu() in idle
+  are modelled for interrupt driven code.
+
+  Peripherals the firmware talks to are modelled on their data pin: a DHT22,
+  DS18B20 sensors on a OneWire bus and a 433MHz gateway that decodes what the
+  RCSwitch transmitter emits.
+*/
+
+#ifndef HostSim_h
+#define HostSim_h
+
+#include <stdint.h>
+
+#define HOST_SIM_MAX_LOADS 8
+#define HOST_SIM_MAX_FRAME_BYTES 16
+
+enum host_mcu_t
+{
+	HOST_MCU_ACTIVE,
+	HOST_MCU_IDLE,
+	HOST_MCU_ADCNR,
+	HOST_MCU_POWERDOWN,
+	HOST_MCU_STARTUP,   // clock source starting up after power-down, the CPU still halted
+	HOST_MCU_STATES
+};
+
+struct HostSimStats
+{
+	uint64_t time_ns;                           // simulated time
+	uint64_t mcu_ns[HOST_MCU_STATES];           // time spent in each MCU state
+	uint64_t load_ns[HOST_SIM_MAX_LOADS];       // on-time of every attached load
+	double   charge_uAs;                        // consumed charge
+	uint32_t ee_bytes_written;                  // EEPROM bytes programmed
+};
+
+struct HostRadioFrame
+{
+	uint16_t bits;                              // frame length in bits
+	uint8_t  data[HOST_SIM_MAX_FRAME_BYTES];    // bits, MSB first
+	uint16_t repeats;                           // how often the frame was received in a row
+};
+
+// clock and state
+void hostSimInit();
+uint64_t hostSimNanos();
+void hostSimSpend(uint64_t ns, host_mcu_t state);
+void hostSimSpendCycles(uint32_t cycles);
+void hostSimSetVcc(uint16_t millivolt);
+void hostSimSetWdtScale(float scale);          // on top of the temperature drift
+float hostSimWdtScale();                        // watchdog period against the nominal 128kHz
+void hostSimTimer0(bool on);                    // false: timer0 stopped (PRR), millis() stands still
+void hostSimFail(const char *msg);
+void hostSimAdcSleep(uint64_t wdtNs);           // ADC noise reduction until the ADC interrupt or the watchdog, 0 = no watchdog
+void hostSimEepromCut(int32_t bytes);           // power fails while the n-th next EEPROM byte is programmed, -1 = never
+
+// wiring
+int hostSimAttachLoad(const char *name, uint8_t pin, int8_t gatePin, float milliampere);
+const char *hostSimLoadName(int load);
+void hostSimAttachRadio(uint8_t dataPin, uint8_t powerPin);
+void hostSimAttachDht22(uint8_t dataPin, uint8_t powerPin);
+void hostSimDht22Flaky(int every);              // the DHT22 ignores every n-th start signal, 0 = never
+void hostSimAttachDs18b20(uint8_t dataPin, uint8_t powerPin, const uint8_t rom[8], float offset);
+void hostSimOneWireTiming(uint32_t *slots, uint32_t *violations); // slots outside the DS18B20 datasheet timing
+void hostSimDs18b20Dead(int n);                 // the n-th attached DS18B20 (from 1) stops answering
+uint32_t hostSimDs18b20Copies();                // COPY SCRATCHPAD commands, writes of the DS18B20 EEPROM
+
+// results
+void hostSimGetStats(HostSimStats *stats);
+int hostSimRadioFrameCount();                   // distinct frames since the last clear
+uint32_t hostSimRadioReceived();                // all frames incl. repeats since start
+void hostSimRadioTiming(uint32_t *pulses, uint64_t *maxErrorNs); // worst edge deviation from protocol 1
+uint64_t hostSimRadioIdleNs();                  // transmitter powered before its first carrier pulse, since start
+const HostRadioFrame *hostSimRadioFrame(int index);
+void hostSimRadioClear();
+
+// the climate the sensors see, degree Celsius and %RH at a simulated time
+float hostSimTemperature(uint64_t ns);
+float hostSimHumidity(uint64_t ns);
+
+// direct port access used by the OneWire library (see OneWire.h)
+volatile uint8_t *hostPinToBaseReg(uint8_t pin);
+uint8_t hostDirectRead(volatile uint8_t *base);
+void hostDirectMode(volatile uint8_t *base, uint8_t mode);
+void hostDirectWrite(volatile uint8_t *base, uint8_t value);
+
+// pin level as seen from outside of the MCU, for the device models
+int8_t hostPinDrive(uint8_t pin);               // -1 not driven, else the driven level
+uint8_t hostPinMode(uint8_t pin);               // INPUT, INPUT_PULLUP or OUTPUT
+void hostPinListen(uint8_t pin, void (*changed)(uint8_t pin));
+void hostPinSetInput(uint8_t pin, int (*level)(uint8_t pin));
+// first level change of the input after 'after', UINT64_MAX if none, wakes up attachInterrupt()
+void hostPinSetEdges(uint8_t pin, uint64_t (*next)(uint8_t pin, uint64_t after));
+
+// implemented by the sketch side of the simulator (HostSketch.cpp)
+const char *hostSketchProfile();
+void hostSketchWire();
+float hostSketchTruth(int value, uint64_t ns);  // what TelemetryFrame value 'value' should be at ns
+double hostSketchInterval();                    // seconds from this wake to the next one the sketch aims at
+int hostSketchSlots();                          // TX_SLOTS of the wake jitter
+unsigned long hostSketchClockSeconds();         // WakeScheduler::clockSeconds() of the sketch
+
+// FastPin against pinMode/digitalWrite/digitalRead for every pin (HostGpioCheck.cpp),
+// returns the number of differences
+int hostGpioCheck();
+// EELog through power cuts (HostEepromCheck.cpp), returns the number of wrong records
+int hostEepromCheck();
+// WakeJitter of nodes in lockstep (HostJitterCheck.cpp), returns the number of failed checks
+int hostJitterCheck(int slots);
+
+#endif
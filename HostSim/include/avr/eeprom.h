@@ -0,0 +1,37 @@
+/*
+  avr/eeprom.h - host stand-in for the avr-libc EEPROM API
+
+  The 1 KB EEPROM of the ATmega328P is an array in the HAL. Writes cost the
+  3.4 ms programming time per byte, eeprom_update_* only pays for bytes that
+  really change. Accesses outside 0..E2END abort the simulation.
+*/
+
+#ifndef _HOST_AVR_EEPROM_H_
+#define _HOST_AVR_EEPROM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <avr/io.h>
+
+uint8_t eeprom_read_byte(const uint8_t *__p);
+uint16_t eeprom_read_word(const uint16_t *__p);
+uint32_t eeprom_read_dword(const uint32_t *__p);
+float eeprom_read_float(const float *__p);
+void eeprom_read_block(void *__dst, const void *__src, size_t __n);
+
+void eeprom_write_byte(uint8_t *__p, uint8_t __value);
+void eeprom_write_word(uint16_t *__p, uint16_t __value);
+void eeprom_write_dword(uint32_t *__p, uint32_t __value);
+void eeprom_write_float(float *__p, float __value);
+void eeprom_write_block(const void *__src, void *__dst, size_t __n);
+
+void eeprom_update_byte(uint8_t *__p, uint8_t __value);
+void eeprom_update_word(uint16_t *__p, uint16_t __value);
+void eeprom_update_dword(uint32_t *__p, uint32_t __value);
+void eeprom_update_float(float *__p, float __value);
+void eeprom_update_block(const void *__src, void *__dst, size_t __n);
+
+#define eeprom_is_ready() 1
+#define eeprom_busy_wait() do {} while (!eeprom_is_ready())
+
+#endif
@@ -0,0 +1,17 @@
+/*
+  avr/interrupt.h - host stand-in, the global interrupt flag is tracked by the HAL
+
+  ISR(vector) defines a plain function named after the vector, the HAL calls
+  it when the modelled peripheral raises the interrupt.
+*/
+
+#ifndef _HOST_AVR_INTERRUPT_H_
+#define _HOST_AVR_INTERRUPT_H_
+
+void cli(void);
+void sei(void);
+
+#define ISR(vector, ...) extern "C" void vector(void); void vector(void)
+#define EMPTY_INTERRUPT(vector) extern "C" void vector(void); void vector(void) {}
+
+#endif
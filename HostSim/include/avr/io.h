@@ -0,0 +1,130 @@
+/*
+  avr/io.h - host stand-in for the ATmega328P special function registers
+
+  Registers are not plain memory on the host: every access goes through
+  hostSfrRead()/hostSfrWrite() so the HAL can react to it (start an ADC
+  conversion, ...). Only the registers the firmware touches are defined.
+*/
+
+#ifndef _HOST_AVR_IO_H_
+#define _HOST_AVR_IO_H_
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(sfr, bit) ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit) (!((sfr) & _BV(bit)))
+#define loop_until_bit_is_set(sfr, bit) do { } while (bit_is_clear(sfr, bit))
+#define loop_until_bit_is_clear(sfr, bit) do { } while (bit_is_set(sfr, bit))
+
+enum host_sfr_t
+{
+	HOST_SFR_ADMUX,
+	HOST_SFR_ADCSRA,
+	HOST_SFR_ADCL,
+	HOST_SFR_ADCH,
+	HOST_SFR_TCCR1A,
+	HOST_SFR_TCCR1B,
+	HOST_SFR_TCNT1,
+	HOST_SFR_OCR1A,
+	HOST_SFR_TIMSK1,
+	HOST_SFR_TIFR1,
+	HOST_SFR_PINB,      // the ports act on the pins of the HAL, see hostSfrRead()
+	HOST_SFR_DDRB,
+	HOST_SFR_PORTB,
+	HOST_SFR_PINC,
+	HOST_SFR_DDRC,
+	HOST_SFR_PORTC,
+	HOST_SFR_PIND,
+	HOST_SFR_DDRD,
+	HOST_SFR_PORTD,
+	HOST_SFR_MCUSR,
+	HOST_SFR_COUNT
+};
+
+uint16_t hostSfrRead(uint8_t sfr);
+void hostSfrWrite(uint8_t sfr, uint16_t value);
+
+class HostSfr
+{
+public:
+	explicit HostSfr(uint8_t sfr) : id(sfr) {}
+	operator uint16_t() const { return hostSfrRead(id); }
+	HostSfr &operator=(uint16_t v) { hostSfrWrite(id, v); return *this; }
+	HostSfr &operator|=(uint16_t v) { hostSfrWrite(id, hostSfrRead(id) | v); return *this; }
+	HostSfr &operator&=(uint16_t v) { hostSfrWrite(id, hostSfrRead(id) & v); return *this; }
+	HostSfr &operator^=(uint16_t v) { hostSfrWrite(id, hostSfrRead(id) ^ v); return *this; }
+
+private:
+	uint8_t id;
+};
+
+#define ADMUX  (HostSfr(HOST_SFR_ADMUX))
+#define ADCSRA (HostSfr(HOST_SFR_ADCSRA))
+#define ADCL   (HostSfr(HOST_SFR_ADCL))
+#define ADCH   (HostSfr(HOST_SFR_ADCH))
+#define TCCR1A (HostSfr(HOST_SFR_TCCR1A))
+#define TCCR1B (HostSfr(HOST_SFR_TCCR1B))
+#define TCNT1  (HostSfr(HOST_SFR_TCNT1))
+#define OCR1A  (HostSfr(HOST_SFR_OCR1A))
+#define TIMSK1 (HostSfr(HOST_SFR_TIMSK1))
+#define TIFR1  (HostSfr(HOST_SFR_TIFR1))
+#define PINB   (HostSfr(HOST_SFR_PINB))
+#define DDRB   (HostSfr(HOST_SFR_DDRB))
+#define PORTB  (HostSfr(HOST_SFR_PORTB))
+#define PINC   (HostSfr(HOST_SFR_PINC))
+#define DDRC   (HostSfr(HOST_SFR_DDRC))
+#define PORTC  (HostSfr(HOST_SFR_PORTC))
+#define PIND   (HostSfr(HOST_SFR_PIND))
+#define DDRD   (HostSfr(HOST_SFR_DDRD))
+#define PORTD  (HostSfr(HOST_SFR_PORTD))
+#define MCUSR  (HostSfr(HOST_SFR_MCUSR))
+
+// ADMUX
+#define REFS1 7
+#define REFS0 6
+#define ADLAR 5
+#define MUX3 3
+#define MUX2 2
+#define MUX1 1
+#define MUX0 0
+
+// ADCSRA
+#define ADEN 7
+#define ADSC 6
+#define ADATE 5
+#define ADIF 4
+#define ADIE 3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+
+// TCCR1B, only CTC mode (WGM12) and normal mode are modelled
+#define ICNC1 7
+#define ICES1 6
+#define WGM13 4
+#define WGM12 3
+#define CS12 2
+#define CS11 1
+#define CS10 0
+
+// TIMSK1, TIFR1
+#define ICIE1 5
+#define OCIE1B 2
+#define OCIE1A 1
+#define TOIE1 0
+#define ICF1 5
+#define OCF1B 2
+#define OCF1A 1
+#define TOV1 0
+
+// MCUSR, the simulation always starts with a power-on reset
+#define WDRF 3
+#define BORF 2
+#define EXTRF 1
+#define PORF 0
+
+#define E2END 0x3FF
+#define E2PAGESIZE 4
+
+#endif
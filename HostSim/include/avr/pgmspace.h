@@ -0,0 +1,21 @@
+/*
+  avr/pgmspace.h - host stand-in, flash and RAM share one address space
+*/
+
+#ifndef _HOST_AVR_PGMSPACE_H_
+#define _HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+#define memcpy_P(dest, src, num) memcpy((dest), (src), (num))
+#define strlen_P(s) strlen(s)
+
+#endif
@@ -0,0 +1,28 @@
+/*
+  avr/sleep.h - host stand-in
+
+  sleep_cpu() advances the simulated clock to the next interrupt of a
+  modelled peripheral (Timer1), charges the time in the selected sleep mode
+  and runs the interrupt routine. Sleeping without a wake up source fails.
+*/
+
+#ifndef _HOST_AVR_SLEEP_H_
+#define _HOST_AVR_SLEEP_H_
+
+#include <stdint.h>
+
+#define SLEEP_MODE_IDLE         (0x00<<1)
+#define SLEEP_MODE_ADC          (0x01<<1)
+#define SLEEP_MODE_PWR_DOWN     (0x02<<1)
+#define SLEEP_MODE_PWR_SAVE     (0x03<<1)
+#define SLEEP_MODE_STANDBY      (0x06<<1)
+#define SLEEP_MODE_EXT_STANDBY  (0x07<<1)
+
+void set_sleep_mode(uint8_t mode);
+void sleep_enable(void);
+void sleep_disable(void);
+void sleep_cpu(void);
+
+#define sleep_mode() do { sleep_enable(); sleep_cpu(); sleep_disable(); } while (0)
+
+#endif
@@ -0,0 +1,110 @@
+/*
+  EventDecode.cpp - timeline of an EventLog dump
+
+  Reads the "ev ..." lines of EventLog::dump() from the serial console of a
+  node (or of sim_<location> -l) and prints the events in the order of the
+  wake counter, with the names and meanings of EVENTLOG_LIST. Faults are in
+  the dump twice while they are still in the RAM ring, once from the EEPROM
+  and once from RAM; the copy from RAM is dropped. Other lines are ignored,
+  several dumps in one file are decoded one after the other.
+
+  The wake counter wraps after 65536 wakes, a timeline across the wrap is
+  out of order.
+
+  usage: evdecode [file]      stdin without file
+*/
+
+#include <Arduino.h>
+#include <EventLog.h>
+
+// events of one dump, a dump has EVENTLOG_EVENTS plus the EEPROM slots
+#define DECODE_EVENTS 512
+
+struct Decoded
+{
+	Event event;
+	bool eeprom;
+};
+
+static const struct
+{
+	uint8_t id;
+	const char *name;
+	const char *text;
+} names[] = {
+#define EVENTLOG_NAME(id, name, text) { id, #name, text },
+	EVENTLOG_LIST(EVENTLOG_NAME)
+#undef EVENTLOG_NAME
+};
+
+static bool sameEvent(const Event &a, const Event &b)
+{
+	return a.id == b.id && a.wake == b.wake && a.arg == b.arg;
+}
+
+static Decoded events[DECODE_EVENTS];
+static int count;
+
+// in the order of the wake counter, events of one wake in the order of the dump
+static void printTimeline()
+{
+	for (int i = 1; i < count; i++) {
+		Decoded d = events[i];
+		int j = i;
+		for (; j > 0 && events[j - 1].event.wake > d.event.wake; j--) events[j] = events[j - 1];
+		events[j] = d;
+	}
+	uint16_t last = count ? events[count - 1].event.wake : 0;
+	printf(" wake    ago  from    event           arg     meaning\n");
+	for (int i = 0; i < count; i++) {
+		const Decoded *d = &events[i];
+		const char *name = "?", *text = "unknown event id";
+		for (size_t n = 0; n < sizeof(names) / sizeof(names[0]); n++) {
+			if (names[n].id != d->event.id) continue;
+			name = names[n].name;
+			text = names[n].text;
+		}
+		printf("%5u %6d  %-6s  %c %-14s %6d  %s\n", d->event.wake, d->event.wake - last,
+			   d->eeprom ? "eeprom" : "ram", d->event.id >= EVENT_FAULT ? '!' : ' ', name, d->event.arg, text);
+	}
+	count = 0;
+}
+
+int main(int argc, char **argv)
+{
+	FILE *in = argc > 1 ? fopen(argv[1], "r") : stdin;
+	if (!in) {
+		fprintf(stderr, "%s: can not open\n", argv[1]);
+		return 1;
+	}
+	bool eeprom = false;
+	int dumps = 0;
+	char line[128];
+	while (fgets(line, sizeof(line), in)) {
+		unsigned wake, id;
+		int arg;
+		char section[16];
+		if (sscanf(line, "ev %u %u %d", &wake, &id, &arg) == 3) {
+			Decoded d;
+			d.event.id = id;
+			d.event.wake = wake;
+			d.event.arg = arg;
+			d.eeprom = eeprom;
+			bool twice = false;
+			for (int i = 0; i < count; i++) twice |= !eeprom && events[i].eeprom && sameEvent(events[i].event, d.event);
+			if (!twice && count < DECODE_EVENTS) events[count++] = d;
+		} else if (sscanf(line, "ev %15s", section) == 1) {
+			if (!strcmp(section, "eeprom")) {
+				if (dumps++) printf("\n");
+				eeprom = true;
+			} else if (!strcmp(section, "ram")) {
+				eeprom = false;
+			} else if (!strcmp(section, "end")) {
+				printTimeline();
+			}
+		}
+	}
+	if (count) printTimeline(); // cut off dump
+	if (in != stdin) fclose(in);
+	return 0;
+}
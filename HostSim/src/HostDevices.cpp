@@ -0,0 +1,652 @@
+/*
+  HostDevices.cpp - peripherals of the host simulator
+
+  - climate: slow daily swing of temperature and humidity
+  - radio: a 433MHz gateway decoding RCSwitch protocol 1 from the air
+  - DHT22: answers the start signal with the 40 bit waveform of the datasheet
+  - DS18B20: OneWire slots, ROM commands incl. search, scratchpad and conversion
+*/
+
+#include <Arduino.h>
+#include <HostSim.h>
+
+/////////////////////////////////////////////////////
+//
+// climate
+//
+
+#define DAY_NS 86400e9
+
+float hostSimTemperature(uint64_t ns)
+{
+	return 21.0 + 1.5 * sin(2 * M_PI * ns / DAY_NS);
+}
+
+float hostSimHumidity(uint64_t ns)
+{
+	return 50.0 - 5.0 * sin(2 * M_PI * ns / DAY_NS);
+}
+
+/////////////////////////////////////////////////////
+//
+// radio gateway, RCSwitch protocol 1: pulse 350us, sync 1/31, "0" 1/3, "1" 3/1
+//
+
+#define RADIO_PULSE_NS 350000.0
+#define RADIO_MAX_FRAMES 64
+
+static struct
+{
+	bool attached;
+	uint8_t dataPin;
+	uint8_t powerPin;
+	uint8_t level;          // carrier on/off
+	uint64_t since;         // time of the last level change
+	uint64_t highNs;        // length of the last carrier pulse
+	HostRadioFrame cur;
+	bool merge;             // identical frame may count as a repeat
+	HostRadioFrame frames[RADIO_MAX_FRAMES];
+	int count;
+	uint32_t received;
+	uint32_t pulseCount;    // carrier pulses and pauses measured
+	uint64_t maxErrorNs;    // worst deviation from a multiple of the pulse length
+	bool powered;
+	bool keyed;             // carrier was on since the transmitter got power
+	uint64_t poweredAt;
+	uint64_t idleNs;        // powered without having sent anything yet
+} radio;
+
+static bool pulses(uint64_t ns, int n)
+{
+	double d = ns - n * RADIO_PULSE_NS;
+	return fabs(d) < RADIO_PULSE_NS * (n > 3 ? 0.3 * n : 0.4);
+}
+
+static void radioFrameEnd()
+{
+	HostRadioFrame &f = radio.cur;
+	if (f.bits == 0) return;
+	radio.received++;
+	HostRadioFrame *last = radio.count ? &radio.frames[radio.count - 1] : 0;
+	if (radio.merge && last && last->bits == f.bits && !memcmp(last->data, f.data, sizeof(f.data))) {
+		last->repeats++;
+	} else if (radio.count < RADIO_MAX_FRAMES) {
+		f.repeats = 1;
+		radio.frames[radio.count++] = f;
+	}
+	memset(&f, 0, sizeof(f));
+	radio.merge = true;
+}
+
+// deviation of a carrier pulse or pause from the protocol timing
+static void radioTiming(uint64_t ns)
+{
+	uint64_t n = (uint64_t)(ns / RADIO_PULSE_NS + 0.5);
+	uint64_t error = (uint64_t)fabs(ns - n * RADIO_PULSE_NS);
+	if (error > radio.maxErrorNs) radio.maxErrorNs = error;
+	radio.pulseCount++;
+}
+
+static void radioPulse(uint64_t highNs, uint64_t lowNs, bool last)
+{
+	HostRadioFrame &f = radio.cur;
+	radioTiming(highNs);
+	if (!last) radioTiming(lowNs); // the last pause ends with the power, not with an edge
+	if (pulses(highNs, 1) && (lowNs > 20 * RADIO_PULSE_NS || (last && lowNs > 4 * RADIO_PULSE_NS))) {
+		radioFrameEnd();
+		return;
+	}
+	int bit;
+	if (pulses(highNs, 1) && pulses(lowNs, 3)) bit = 0;
+	else if (pulses(highNs, 3) && pulses(lowNs, 1)) bit = 1;
+	else bit = -1;
+	if (bit < 0 || f.bits >= HOST_SIM_MAX_FRAME_BYTES * 8) {
+		memset(&f, 0, sizeof(f)); // noise
+		return;
+	}
+	if (bit) f.data[f.bits / 8] |= 0x80 >> (f.bits % 8);
+	f.bits++;
+}
+
+static void radioChanged(uint8_t pin)
+{
+	bool powered = hostPinDrive(radio.powerPin) == HIGH;
+	uint8_t level = powered && hostPinDrive(radio.dataPin) == HIGH;
+	uint64_t now = hostSimNanos();
+	if (powered != radio.powered) {
+		if (powered) radio.keyed = false;
+		else if (!radio.keyed) radio.idleNs += now - radio.poweredAt;
+		radio.powered = powered;
+		radio.poweredAt = now;
+	}
+	if (level && !radio.keyed) {
+		radio.idleNs += now - radio.poweredAt;
+		radio.keyed = true;
+	}
+	if (!powered && !level && !radio.level && radio.highNs) {
+		// transmitter switched off, the last low ends here
+		radioPulse(radio.highNs, now - radio.since, true);
+		radio.highNs = 0;
+		radio.merge = false;
+		return;
+	}
+	if (level == radio.level) return;
+	if (level) {
+		if (radio.highNs) radioPulse(radio.highNs, now - radio.since, false);
+	} else {
+		radio.highNs = now - radio.since;
+	}
+	radio.level = level;
+	radio.since = now;
+}
+
+void hostSimAttachRadio(uint8_t dataPin, uint8_t powerPin)
+{
+	radio.attached = true;
+	radio.dataPin = dataPin;
+	radio.powerPin = powerPin;
+	hostPinListen(dataPin, radioChanged);
+	hostPinListen(powerPin, radioChanged);
+}
+
+int hostSimRadioFrameCount()
+{
+	return radio.count;
+}
+
+const HostRadioFrame *hostSimRadioFrame(int index)
+{
+	return (index < radio.count) ? &radio.frames[index] : 0;
+}
+
+void hostSimRadioTiming(uint32_t *pulses, uint64_t *maxErrorNs)
+{
+	*pulses = radio.pulseCount;
+	*maxErrorNs = radio.maxErrorNs;
+}
+
+uint64_t hostSimRadioIdleNs()
+{
+	return radio.idleNs;
+}
+
+uint32_t hostSimRadioReceived()
+{
+	return radio.received;
+}
+
+void hostSimRadioClear()
+{
+	radio.count = 0;
+	radio.merge = false;
+}
+
+/////////////////////////////////////////////////////
+//
+// DHT22
+//
+
+#define DHT_WARMUP_NS     500000000ULL // needs this long after power up before it answers
+#define DHT_START_MIN_NS  800000ULL    // start signal: host pulls low at least this long
+#define DHT_EDGES         (4 + 40 * 2 + 2)
+
+static struct
+{
+	bool attached;
+	uint8_t dataPin;
+	uint8_t powerPin;
+	bool powered;
+	uint64_t poweredAt;
+	bool hostLow;
+	uint64_t lowSince;
+	uint64_t edgeAt[DHT_EDGES];
+	uint8_t edgeLevel[DHT_EDGES];
+	uint8_t edges;
+	int flaky;              // ignore every n-th start signal
+	int starts;
+} dht;
+
+static void dhtEdge(uint64_t at, uint8_t level)
+{
+	dht.edgeAt[dht.edges] = at;
+	dht.edgeLevel[dht.edges] = level;
+	dht.edges++;
+}
+
+static void dhtRespond(uint64_t t)
+{
+	uint8_t bits[5];
+	uint16_t hum = (uint16_t)lround(hostSimHumidity(t) * 10);
+	float temperature = hostSimTemperature(t);
+	uint16_t temp = (uint16_t)lround(fabs(temperature) * 10);
+	if (temperature < 0) temp |= 0x8000;
+	bits[0] = hum >> 8;
+	bits[1] = hum & 0xFF;
+	bits[2] = temp >> 8;
+	bits[3] = temp & 0xFF;
+	bits[4] = bits[0] + bits[1] + bits[2] + bits[3];
+
+	dht.edges = 0;
+	dhtEdge(t, HIGH);                   // released, pulled up
+	t += 30000;  dhtEdge(t, LOW);       // response 80us low
+	t += 80000;  dhtEdge(t, HIGH);      // 80us high
+	t += 80000;
+	for (uint8_t i = 0; i < 40; i++) {
+		dhtEdge(t, LOW);                // 50us low per bit
+		t += 50000;
+		dhtEdge(t, HIGH);               // 26-28us high "0", 70us high "1"
+		t += (bits[i / 8] & (0x80 >> (i % 8))) ? 70000 : 27000;
+	}
+	dhtEdge(t, LOW);
+	t += 50000;
+	dhtEdge(t, HIGH);
+}
+
+static int dhtLevel(uint8_t pin)
+{
+	if (!dht.powered) return LOW;
+	int8_t drive = hostPinDrive(pin);
+	if (drive >= 0) return drive;
+	uint64_t now = hostSimNanos();
+	int level = HIGH;
+	for (uint8_t i = 0; i < dht.edges && dht.edgeAt[i] <= now; i++) level = dht.edgeLevel[i];
+	return level;
+}
+
+static uint64_t dhtNextEdge(uint8_t pin, uint64_t after)
+{
+	if (!dht.powered || hostPinDrive(pin) >= 0) return UINT64_MAX;
+	for (uint8_t i = 0; i < dht.edges; i++) {
+		if (dht.edgeAt[i] > after) return dht.edgeAt[i];
+	}
+	return UINT64_MAX;
+}
+
+static void dhtChanged(uint8_t pin)
+{
+	uint64_t now = hostSimNanos();
+	if (pin == dht.powerPin) {
+		bool powered = hostPinDrive(dht.powerPin) == HIGH;
+		if (powered && !dht.powered) dht.poweredAt = now;
+		if (!powered) dht.edges = 0;
+		dht.powered = powered;
+		return;
+	}
+	bool low = hostPinDrive(dht.dataPin) == LOW;
+	if (low && !dht.hostLow) {
+		dht.lowSince = now;
+		dht.edges = 0;
+	} else if (!low && dht.hostLow) {
+		if (dht.powered && now - dht.lowSince >= DHT_START_MIN_NS && now - dht.poweredAt >= DHT_WARMUP_NS) {
+			dht.starts++;
+			if (!dht.flaky || dht.starts % dht.flaky) dhtRespond(now);
+		}
+	}
+	dht.hostLow = low;
+}
+
+void hostSimDht22Flaky(int every)
+{
+	dht.flaky = every;
+}
+
+void hostSimAttachDht22(uint8_t dataPin, uint8_t powerPin)
+{
+	dht.attached = true;
+	dht.dataPin = dataPin;
+	dht.powerPin = powerPin;
+	hostPinListen(dataPin, dhtChanged);
+	hostPinListen(powerPin, dhtChanged);
+	hostPinSetInput(dataPin, dhtLevel);
+	hostPinSetEdges(dataPin, dhtNextEdge);
+}
+
+/////////////////////////////////////////////////////
+//
+// DS18B20 on a OneWire bus
+//
+
+#define DS_MAX              4
+#define DS_RESET_MIN_NS     480000ULL - 10000ULL
+#define DS_WRITE0_MIN_NS    15000ULL
+#define DS_COPY_NS          10000000ULL
+
+// standard speed timing limits of the datasheet, checked on every slot
+#define OW_RSTL_MIN_NS      480000ULL   // reset low
+#define OW_RSTH_MIN_NS      480000ULL   // reset release to the first slot
+#define OW_SLOT_MIN_NS      60000ULL    // fall to fall of two slots
+#define OW_REC_MIN_NS       1000ULL     // recovery between slots
+#define OW_LOW1_MIN_NS      1000ULL     // write 1 and read slot low time
+#define OW_LOW1_MAX_NS      15000ULL
+#define OW_LOW0_MIN_NS      60000ULL    // write 0 low time
+#define OW_LOW0_MAX_NS      120000ULL
+#define OW_RDV_NS           15000ULL    // a read slot is sampled within this after its fall
+
+enum ow_low_t
+{
+	OW_NONE,            // nothing since power up
+	OW_RESET,
+	OW_SLOT
+};
+
+enum ds_state_t
+{
+	DS_ROM_CMD,         // receive ROM command
+	DS_MATCH,           // receive ROM code of match ROM
+	DS_SEARCH,          // search ROM triplets
+	DS_TX,              // transmit txBuf, then DS_DONE
+	DS_FUNC_CMD,        // receive function command
+	DS_WRITE_SCRATCH,   // receive TH, TL, config
+	DS_CONVERT,         // read slots return 0 while busy
+	DS_DONE,            // read slots return 1
+	DS_IDLE             // not selected, wait for reset
+};
+
+struct Ds18b20
+{
+	uint8_t rom[8];
+	float offset;
+	uint8_t scratch[9];
+	uint8_t ee[3];          // TH, TL, config in the device EEPROM
+	int16_t pendingRaw;
+	uint64_t busyUntil;
+	bool converting;
+	bool dead;              // no presence pulse, no answer, see hostSimDs18b20Dead()
+
+	uint8_t state;
+	uint8_t rxByte;
+	uint8_t rxBits;
+	uint8_t rxCount;
+	uint8_t txBuf[9];
+	uint8_t txBits;         // bits in txBuf
+	uint8_t txPos;          // next bit to send
+	uint8_t searchBit;      // 0..63
+	uint8_t searchPhase;    // 0 bit, 1 complement, 2 direction
+};
+
+static struct
+{
+	bool attached;
+	uint8_t dataPin;
+	uint8_t powerPin;
+	bool powered;
+	bool masterLow;
+	uint64_t fallAt;
+	uint64_t holdFrom;      // devices pull the line low in [holdFrom, holdUntil)
+	uint64_t holdUntil;
+	Ds18b20 dev[DS_MAX];
+	uint8_t count;
+
+	uint8_t lastLow;        // ow_low_t of the last low pulse of the master
+	uint64_t lowNs;         // its length
+	uint64_t riseAt;        // its end
+	bool sampled;           // the slot was read by the master
+	uint32_t slots;
+	uint32_t violations;
+	uint32_t copies;        // COPY SCRATCHPAD commands, 3 bytes of device EEPROM each
+} bus;
+
+static void owViolation(const char *what, uint64_t ns)
+{
+	if (!bus.violations) fprintf(stderr, "onewire: %s %.1f us\n", what, ns / 1000.0);
+	bus.violations++;
+}
+
+static uint8_t dsCrc8(const uint8_t *p, uint8_t len)
+{
+	uint8_t crc = 0;
+	while (len--) {
+		uint8_t in = *p++;
+		for (uint8_t i = 8; i; i--) {
+			uint8_t mix = (crc ^ in) & 0x01;
+			crc >>= 1;
+			if (mix) crc ^= 0x8C;
+			in >>= 1;
+		}
+	}
+	return crc;
+}
+
+static uint8_t dsResolution(const Ds18b20 &d)
+{
+	return 9 + ((d.scratch[4] >> 5) & 0x03);
+}
+
+static void dsPowerUp(Ds18b20 &d)
+{
+	d.scratch[0] = 0x50; // 85.0 degree power on value
+	d.scratch[1] = 0x05;
+	d.scratch[2] = d.ee[0];
+	d.scratch[3] = d.ee[1];
+	d.scratch[4] = d.ee[2];
+	d.scratch[5] = 0xFF;
+	d.scratch[6] = 0x0C;
+	d.scratch[7] = 0x10;
+	d.converting = false;
+	d.busyUntil = 0;
+	d.state = DS_IDLE;
+}
+
+static void dsUpdate(Ds18b20 &d, uint64_t now)
+{
+	if (d.converting && now >= d.busyUntil) {
+		d.scratch[0] = d.pendingRaw & 0xFF;
+		d.scratch[1] = (uint16_t)d.pendingRaw >> 8;
+		d.converting = false;
+	}
+}
+
+static void dsStartTx(Ds18b20 &d, const uint8_t *data, uint8_t bits)
+{
+	memcpy(d.txBuf, data, (bits + 7) / 8);
+	d.txBits = bits;
+	d.txPos = 0;
+	d.state = DS_TX;
+}
+
+static bool romBit(const Ds18b20 &d, uint8_t i)
+{
+	return d.rom[i / 8] & (1 << (i % 8));
+}
+
+static void dsRxByte(Ds18b20 &d, uint8_t v, uint64_t now)
+{
+	if (d.state == DS_ROM_CMD) {
+		switch (v) {
+			case 0xCC: d.state = DS_FUNC_CMD; break;
+			case 0x55: d.state = DS_MATCH; d.rxCount = 0; break;
+			case 0xF0: d.state = DS_SEARCH; d.searchBit = 0; d.searchPhase = 0; break;
+			case 0x33: dsStartTx(d, d.rom, 64); break;
+			default:   d.state = DS_IDLE; break;
+		}
+	} else if (d.state == DS_FUNC_CMD) {
+		switch (v) {
+			case 0x44: {
+				uint8_t res = dsResolution(d);
+				int16_t raw = (int16_t)lround((hostSimTemperature(now) + d.offset) * 16);
+				d.pendingRaw = raw & ~((1 << (12 - res)) - 1);
+				d.busyUntil = now + (93750000ULL << (res - 9));
+				d.converting = true;
+				d.state = DS_CONVERT;
+				break;
+			}
+			case 0xBE:
+				dsUpdate(d, now);
+				d.scratch[8] = dsCrc8(d.scratch, 8);
+				dsStartTx(d, d.scratch, 72);
+				break;
+			case 0x4E: d.state = DS_WRITE_SCRATCH; d.rxCount = 0; break;
+			case 0x48:
+				memcpy(d.ee, &d.scratch[2], 3);
+				bus.copies++;
+				d.busyUntil = now + DS_COPY_NS;
+				d.state = DS_CONVERT;
+				break;
+			case 0xB8: memcpy(&d.scratch[2], d.ee, 3); d.state = DS_DONE; break;
+			case 0xB4: { uint8_t external = 1; dsStartTx(d, &external, 1); break; }
+			default:   d.state = DS_IDLE; break;
+		}
+	} else if (d.state == DS_WRITE_SCRATCH) {
+		d.scratch[2 + d.rxCount++] = v;
+		if (d.rxCount == 3) d.state = DS_DONE;
+	}
+}
+
+// returns true if the device pulls the line low for this slot
+static bool dsSlot(Ds18b20 &d, uint8_t written, uint64_t now)
+{
+	dsUpdate(d, now);
+	switch (d.state) {
+		case DS_TX: {
+			bool b = d.txBuf[d.txPos / 8] & (1 << (d.txPos % 8));
+			if (++d.txPos >= d.txBits) d.state = DS_DONE;
+			return !b;
+		}
+		case DS_SEARCH: {
+			bool b = romBit(d, d.searchBit);
+			if (d.searchPhase == 0) { d.searchPhase = 1; return !b; }
+			if (d.searchPhase == 1) { d.searchPhase = 2; return b; }
+			d.searchPhase = 0;
+			if (written != b) d.state = DS_IDLE;
+			else if (++d.searchBit == 64) d.state = DS_FUNC_CMD;
+			return false;
+		}
+		case DS_MATCH:
+			if (written != romBit(d, d.rxCount)) d.state = DS_IDLE;
+			else if (++d.rxCount == 64) d.state = DS_FUNC_CMD;
+			return false;
+		case DS_CONVERT:
+			return now < d.busyUntil;
+		case DS_ROM_CMD:
+		case DS_FUNC_CMD:
+		case DS_WRITE_SCRATCH:
+			if (written) d.rxByte |= 1 << d.rxBits;
+			if (++d.rxBits == 8) {
+				uint8_t v = d.rxByte;
+				d.rxByte = 0;
+				d.rxBits = 0;
+				dsRxByte(d, v, now);
+			}
+			return false;
+		default:
+			return false;
+	}
+}
+
+static int busLevel(uint8_t pin)
+{
+	if (!bus.powered) return LOW;
+	int8_t drive = hostPinDrive(pin);
+	if (drive >= 0) return drive;
+	uint64_t now = hostSimNanos();
+	if (bus.lastLow == OW_SLOT && bus.lowNs < OW_LOW1_MAX_NS && !bus.sampled && !bus.masterLow &&
+		now - bus.fallAt < OW_SLOT_MIN_NS) {
+		bus.sampled = true;
+		if (now - bus.fallAt > OW_RDV_NS) owViolation("read slot sampled late", now - bus.fallAt);
+	}
+	return (now >= bus.holdFrom && now < bus.holdUntil) ? LOW : HIGH;
+}
+
+static void busChanged(uint8_t pin)
+{
+	uint64_t now = hostSimNanos();
+	if (pin == bus.powerPin) {
+		bool powered = hostPinDrive(bus.powerPin) == HIGH;
+		if (powered && !bus.powered) {
+			for (uint8_t i = 0; i < bus.count; i++) dsPowerUp(bus.dev[i]);
+			bus.lastLow = OW_NONE;
+		}
+		bus.powered = powered;
+		return;
+	}
+	bool low = hostPinDrive(bus.dataPin) == LOW;
+	if (low == bus.masterLow) return;
+	bus.masterLow = low;
+	if (low) {
+		if (bus.powered && bus.lastLow != OW_NONE) {
+			if (now - bus.riseAt < OW_REC_MIN_NS) owViolation("recovery", now - bus.riseAt);
+			if (bus.lastLow == OW_RESET && now - bus.riseAt < OW_RSTH_MIN_NS) owViolation("reset high", now - bus.riseAt);
+			if (bus.lastLow == OW_SLOT && now - bus.fallAt < OW_SLOT_MIN_NS) owViolation("slot", now - bus.fallAt);
+		}
+		bus.fallAt = now;
+		bus.sampled = false;
+		return;
+	}
+	if (!bus.powered) return;
+
+	uint64_t d = now - bus.fallAt;
+	bus.lowNs = d;
+	bus.riseAt = now;
+	if (d >= DS_RESET_MIN_NS) {
+		bus.lastLow = OW_RESET;
+		if (d < OW_RSTL_MIN_NS) owViolation("reset low", d);
+		// reset, all devices answer with a presence pulse
+		bool presence = false;
+		for (uint8_t i = 0; i < bus.count; i++) {
+			Ds18b20 &dev = bus.dev[i];
+			dsUpdate(dev, now);
+			dev.state = dev.dead ? DS_IDLE : DS_ROM_CMD;
+			dev.rxByte = 0;
+			dev.rxBits = 0;
+			if (!dev.dead) presence = true;
+		}
+		if (presence) {
+			bus.holdFrom = now + 30000;
+			bus.holdUntil = now + 150000;
+		}
+		return;
+	}
+	// short low: write "1" or read slot, long low: write "0"
+	bus.lastLow = OW_SLOT;
+	bus.slots++;
+	if (d < OW_LOW1_MIN_NS || (d > OW_LOW1_MAX_NS && d < OW_LOW0_MIN_NS) || d > OW_LOW0_MAX_NS) {
+		owViolation("slot low", d);
+	}
+	uint8_t written = d < DS_WRITE0_MIN_NS;
+	bool pull = false;
+	for (uint8_t i = 0; i < bus.count; i++) {
+		if (dsSlot(bus.dev[i], written, now)) pull = true;
+	}
+	if (pull && written) {
+		bus.holdFrom = now;
+		bus.holdUntil = bus.fallAt + 30000;
+	}
+}
+
+void hostSimOneWireTiming(uint32_t *slots, uint32_t *violations)
+{
+	*slots = bus.slots;
+	*violations = bus.violations;
+}
+
+uint32_t hostSimDs18b20Copies()
+{
+	return bus.copies;
+}
+
+void hostSimDs18b20Dead(int n)
+{
+	if (n < 1 || n > bus.count) hostSimFail("no such DS18B20");
+	bus.dev[n - 1].dead = true;
+}
+
+void hostSimAttachDs18b20(uint8_t dataPin, uint8_t powerPin, const uint8_t rom[8], float offset)
+{
+	if (bus.count >= DS_MAX) hostSimFail("too many DS18B20");
+	if (!bus.attached) {
+		bus.attached = true;
+		bus.dataPin = dataPin;
+		bus.powerPin = powerPin;
+		hostPinListen(dataPin, busChanged);
+		hostPinListen(powerPin, busChanged);
+		hostPinSetInput(dataPin, busLevel);
+	}
+	Ds18b20 &d = bus.dev[bus.count++];
+	memset(&d, 0, sizeof(d));
+	memcpy(d.rom, rom, 8);
+	d.offset = offset;
+	d.ee[0] = 0x4B; // factory TH, TL, 12 bit
+	d.ee[1] = 0x46;
+	d.ee[2] = 0x7F;
+	dsPowerUp(d);
+}
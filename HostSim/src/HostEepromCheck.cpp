@@ -0,0 +1,151 @@
+/*
+  HostEepromCheck.cpp - EELog through power cuts
+
+  A small log of a few slots is written to many times, so that the sequence
+  numbers wrap around several times, with every record written once
+  (append) and written several times in place. Every third write is cut short
+  by a power failure after a varying number of programmed bytes, the node
+  "resets" then: a new EELog finds the newest record with begin(). It has to
+  be the record just written, or the one before: for a cut append the record
+  of the slot before, for a cut write in place the record before that slot
+  was last moved on, so any older record is accepted there. Writes that go
+  through have to be found by a new EELog right away.
+
+  The same runs with records of 3, 4 and 5 bytes on the whole EEPROM, more
+  slots than the sequence numbers can order: the log has to limit itself to
+  EELOG_MAX_SLOTS of them, else a begin() after a cut in slot 0 takes an old
+  record for the newest one. With records that short, one of the cuts hits a
+  CRC that matches a mix of old and new bytes, unless the slot is erased
+  while it is written.
+*/
+
+#include <Arduino.h>
+#include <HostSim.h>
+#include <EELog.h>
+#include <avr/eeprom.h>
+
+#define CHECK_START     16
+#define CHECK_SLOTS     7
+#define CHECK_WRITES    4000
+
+struct CheckRecord
+{
+	uint32_t counter;
+	uint16_t check;         // ~counter, the record differs in every byte
+};
+
+// 204, 170 and 146 slots of the whole EEPROM
+struct ShortRecord
+{
+	uint16_t counter;
+	uint8_t check;
+} __attribute__((packed));
+
+struct MidRecord
+{
+	uint16_t counter;
+	uint16_t check;
+};
+
+struct LargeRecord
+{
+	uint32_t counter;
+	uint8_t check;
+} __attribute__((packed));
+
+#define CHECK_END (CHECK_START + CHECK_SLOTS * (sizeof(CheckRecord) + 2) - 1)
+
+template <typename Record>
+static bool found(EELog *log, Record *record)
+{
+	return log->begin() && log->read(record);
+}
+
+template <typename Record>
+static int checkLog(uint16_t start, uint16_t end, uint8_t rewrites, int *cuts)
+{
+	uint8_t erased[E2END + 1];
+	memset(erased, 0xFF, sizeof(erased));
+	eeprom_write_block(erased, (void*)(uintptr_t)start, end + 1 - start);
+
+	EELog *log = new EELog(start, end, sizeof(Record), rewrites);
+	Record record, last, now;
+	int wrong = 0;
+	bool stored = false;
+
+	if (log->slots() > EELOG_MAX_SLOTS) {
+		printf("eelog: %u slots, more than EELOG_MAX_SLOTS\n", log->slots());
+		wrong++;
+	}
+	if (log->begin()) {
+		printf("eelog: a record on the erased EEPROM\n");
+		wrong++;
+	}
+	for (uint32_t i = 0; i < CHECK_WRITES; i++) {
+		record.counter = i;
+		record.check = ~record.counter;
+		int32_t cut = i % 3 ? 0 : 1 + (i / 3) % (sizeof(Record) + 3);
+		hostSimEepromCut(cut ? cut : -1);
+		log->write(&record);
+		hostSimEepromCut(-1);
+
+		EELog reader(start, end, sizeof(Record), rewrites);
+		bool any = found(&reader, &now);
+		if (!cut) {
+			if (!any || memcmp(&now, &record, sizeof(record))) {
+				printf("eelog: x%u: write %u not found\n", rewrites, i);
+				wrong++;
+			}
+			last = record;
+			stored = true;
+			continue;
+		}
+
+		(*cuts)++;
+		delete log;
+		log = new EELog(start, end, sizeof(Record), rewrites);
+		log->begin();
+		if (!any) {
+			if (stored) {
+				printf("eelog: x%u: no record after write %u, cut after %d bytes\n", rewrites, i, cut);
+				wrong++;
+			}
+			continue;
+		}
+		if (!memcmp(&now, &record, sizeof(record))) {
+			last = record;
+			stored = true;
+			continue;
+		}
+		bool older = stored && now.check == (decltype(now.check))~now.counter && now.counter <= last.counter;
+		if (rewrites == 1 ? !stored || memcmp(&now, &last, sizeof(last)) : !older) {
+			printf("eelog: x%u: record %u after write %u, cut after %d bytes\n", rewrites, now.counter, i, cut);
+			wrong++;
+		}
+		last = now;
+	}
+	delete log;
+	return wrong;
+}
+
+// records of the given type on the whole EEPROM
+template <typename Record>
+static int checkArea()
+{
+	int cuts = 0;
+	int wrong = checkLog<Record>(0, E2END, 1, &cuts) + checkLog<Record>(0, E2END, 4, &cuts);
+	printf("eelog: %u writes of %u bytes in %u of %u slots twice, %d power cuts, %d wrong records\n",
+		   2 * CHECK_WRITES, (unsigned)sizeof(Record), EELOG_MAX_SLOTS,
+		   (unsigned)((E2END + 1) / (sizeof(Record) + 2)), cuts, wrong);
+	return wrong;
+}
+
+int hostEepromCheck()
+{
+	int cuts = 0;
+	int wrong = checkLog<CheckRecord>(CHECK_START, CHECK_END, 1, &cuts) +
+				checkLog<CheckRecord>(CHECK_START, CHECK_END, 4, &cuts);
+	printf("eelog: %u writes in %u slots twice, %d power cuts, %d wrong records\n",
+		   2 * CHECK_WRITES, CHECK_SLOTS, cuts, wrong);
+	return wrong + checkArea<ShortRecord>() + checkArea<MidRecord>() + checkArea<LargeRecord>();
+}
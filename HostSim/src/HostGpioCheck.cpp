@@ -0,0 +1,129 @@
+/*
+  HostGpioCheck.cpp - FastPin against pinMode/digitalWrite/digitalRead
+
+  Every pin runs through the same sequence of calls twice: once through the
+  ArduinoCore API of the HAL, which works on pin numbers, and once through
+  FastPin, which works on the PIN, DDR and PORT registers the HAL maps with the
+  tables of the standard variant. After every step all pins have to be in the
+  same state and read the same: a FastPin that computes the wrong port or bit
+  shows up as a difference on some pin.
+*/
+
+#include <Arduino.h>
+#include <HostSim.h>
+#include <FastGPIO.h>
+
+enum op_t
+{
+	OP_OUTPUT,
+	OP_HIGH,
+	OP_LOW,
+	OP_INPUT_PULLUP,
+	OP_INPUT,
+	OP_WRITE_HIGH,      // on an input: pull up on
+	OP_WRITE_LOW        // on an input: pull up off
+};
+
+static const uint8_t sequence[] = {
+	OP_OUTPUT, OP_HIGH, OP_LOW, OP_HIGH, OP_INPUT, OP_OUTPUT, OP_INPUT_PULLUP,
+	OP_OUTPUT, OP_LOW, OP_INPUT_PULLUP, OP_INPUT, OP_WRITE_HIGH, OP_WRITE_LOW, OP_INPUT
+};
+#define STEPS (sizeof(sequence) / sizeof(sequence[0]))
+
+static const char *opName[] = {
+	"OUTPUT", "HIGH", "LOW", "INPUT_PULLUP", "INPUT", "write HIGH", "write LOW"
+};
+
+struct PinState
+{
+	uint8_t mode;
+	uint8_t out;
+	int8_t drive;
+};
+
+static void snapshot(PinState *state)
+{
+	for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+		state[pin].mode = hostPinMode(pin);
+		state[pin].out = digitalRead(pin);
+		state[pin].drive = hostPinDrive(pin);
+	}
+}
+
+static void apiOp(uint8_t pin, uint8_t op)
+{
+	switch (op) {
+		case OP_OUTPUT:       pinMode(pin, OUTPUT); break;
+		case OP_HIGH:         digitalWrite(pin, HIGH); break;
+		case OP_LOW:          digitalWrite(pin, LOW); break;
+		case OP_INPUT_PULLUP: pinMode(pin, INPUT_PULLUP); break;
+		case OP_INPUT:        pinMode(pin, INPUT); break;
+		case OP_WRITE_HIGH:   digitalWrite(pin, HIGH); break;
+		case OP_WRITE_LOW:    digitalWrite(pin, LOW); break;
+	}
+}
+
+template <uint8_t Pin>
+static void fastOp(uint8_t op)
+{
+	switch (op) {
+		case OP_OUTPUT:       FastPin<Pin>::mode(OUTPUT); break;
+		case OP_HIGH:         FastPin<Pin>::high(); break;
+		case OP_LOW:          FastPin<Pin>::low(); break;
+		case OP_INPUT_PULLUP: FastPin<Pin>::mode(INPUT_PULLUP); break;
+		case OP_INPUT:        FastPin<Pin>::mode(INPUT); break;
+		case OP_WRITE_HIGH:   FastPin<Pin>::write(HIGH); break;
+		case OP_WRITE_LOW:    FastPin<Pin>::write(LOW); break;
+	}
+}
+
+template <uint8_t Pin>
+static int checkPin()
+{
+	PinState api[STEPS][NUM_DIGITAL_PINS], fast[NUM_DIGITAL_PINS];
+	int differences = 0;
+
+	pinMode(Pin, INPUT);
+	for (uint8_t i = 0; i < STEPS; i++) {
+		apiOp(Pin, sequence[i]);
+		snapshot(api[i]);
+	}
+	pinMode(Pin, INPUT);
+	for (uint8_t i = 0; i < STEPS; i++) {
+		fastOp<Pin>(sequence[i]);
+		snapshot(fast);
+		if (FastPin<Pin>::read() != fast[Pin].out) {
+			printf("gpio: pin %u after %s: FastPin reads %u, digitalRead %u\n",
+				   Pin, opName[sequence[i]], FastPin<Pin>::read(), fast[Pin].out);
+			differences++;
+		}
+		for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+			if (memcmp(&api[i][pin], &fast[pin], sizeof(PinState)) == 0) continue;
+			printf("gpio: pin %u after %s of pin %u: mode %u/%u level %u/%u (api/FastPin)\n",
+				   pin, opName[sequence[i]], Pin, api[i][pin].mode, fast[pin].mode, api[i][pin].out, fast[pin].out);
+			differences++;
+		}
+	}
+	pinMode(Pin, INPUT);
+	return differences;
+}
+
+template <uint8_t Pin>
+struct CheckPins
+{
+	static int run() { return CheckPins<Pin - 1>::run() + checkPin<Pin>(); }
+};
+
+template <>
+struct CheckPins<0>
+{
+	static int run() { return checkPin<0>(); }
+};
+
+int hostGpioCheck()
+{
+	int differences = CheckPins<NUM_DIGITAL_PINS - 1>::run();
+	printf("gpio: FastPin on %u pins, %u steps each, %d differences to the ArduinoCore API\n",
+		   NUM_DIGITAL_PINS, (unsigned)STEPS, differences);
+	return differences;
+}
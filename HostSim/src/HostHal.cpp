@@ -0,0 +1,792 @@
+/*
+  HostHal.cpp - Arduino API of the host simulator
+
+  Time only moves when the firmware does something: every API call is charged
+  with the cycles it takes on the ATmega328P at F_CPU, delays and sleeps with
+  their duration. While time moves, the current of the MCU state and of every
+  switched-on load is integrated into the consumed charge.
+
+  Cycle counts are approximations of the avr-gcc 5.4 -Os code of ArduinoCore,
+  the currents are datasheet typicals at 5V and 8MHz.
+*/
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <HostSim.h>
+
+// current of the MCU itself per state, mA
+static const float mcu_mA[HOST_MCU_STATES] = {
+	4.0,    // active
+	1.2,    // idle
+	0.9,    // ADC noise reduction
+	0.005,  // power-down, watchdog running, BOD off
+	0.2     // start-up after power-down, the oscillator running, about the standby current
+};
+
+// cycles of the ArduinoCore calls (table lookups, turnOffPWM, SREG save)
+#define CYCLES_PINMODE      50
+#define CYCLES_DIGITALWRITE 57
+#define CYCLES_DIGITALREAD  52
+#define CYCLES_MICROS       28
+#define CYCLES_DIRECT_IO    5   // ldd, and/or, std through the base register pointer
+#define CYCLES_EEPROM_READ  12
+#define CYCLES_ISR          10  // interrupt response, vector jump, reti
+#define CYCLES_EXT_ISR      60  // WInterrupts.c dispatcher around the attachInterrupt() handler
+
+#define EEPROM_WRITE_NS     3400000ULL // 3.4 ms programming time per byte
+#define NS_PER_CYCLE        (1000000000ULL / F_CPU)
+
+#define NUM_PINS            NUM_DIGITAL_PINS
+#define EXT_INTERRUPTS      2   // INT0 on pin 2, INT1 on pin 3
+#define TIMER0_OVF_NS       (64ULL * 256ULL * NS_PER_CYCLE) // millis() interrupt, wakes up idle
+#define MAX_LISTENERS       4
+
+struct Pin
+{
+	uint8_t mode;
+	uint8_t out;
+	void (*listener[MAX_LISTENERS])(uint8_t pin);
+	int (*input)(uint8_t pin);
+	uint64_t (*nextEdge)(uint8_t pin, uint64_t after);
+};
+
+struct ExtInt
+{
+	void (*handler)(void);
+	int mode;
+	uint8_t level;      // pin level at the last edge
+	uint64_t seen;      // edges up to here are handled
+	bool pending;       // INTFn, handler runs when interrupts are enabled
+};
+
+struct Load
+{
+	const char *name;
+	uint8_t pin;
+	int8_t gate;
+	float mA;
+};
+
+static Pin pins[NUM_PINS];
+static volatile uint8_t pinBase[NUM_PINS];
+static Load loads[HOST_SIM_MAX_LOADS];
+static int loadCount;
+
+static HostSimStats stats;
+static uint64_t timer0_ns;          // time timer0 was running, basis of millis()/micros()
+static uint16_t vcc_mV = 5000;
+static float wdtScale = 1.0;
+static bool timer0On = true;        // PRTIM0 clear
+static uint32_t noise = 12345;      // LCG for the ADC noise
+
+static uint8_t eeprom[E2END + 1];
+static bool eepromInit;
+static int32_t eeCut = -1;              // bytes until the power fails, see hostSimEepromCut()
+
+static uint16_t sfr[HOST_SFR_COUNT];
+static bool adcFirst = true;        // first conversion after enabling the ADC takes longer
+
+static bool interruptsOn = true;    // I flag of SREG
+static bool inIsr;
+static uint64_t t1Base;             // time TCNT1 was 0, while timer1 runs
+static bool sleepEnabled;
+static uint8_t sleepMode;
+static ExtInt extInt[EXT_INTERRUPTS];
+static uint32_t isrCount;           // ISRs run so far, a sleep ends with an ISR
+
+extern "C" void TIMER1_COMPA_vect(void) __attribute__((weak));
+extern "C" void ADC_vect(void) __attribute__((weak));
+
+HardwareSerial Serial;
+
+/////////////////////////////////////////////////////
+//
+// clock and energy
+//
+
+static bool loadOn(const Load &l)
+{
+	if (pins[l.pin].mode != OUTPUT || !pins[l.pin].out) return false;
+	if (l.gate >= 0 && (pins[l.gate].mode != OUTPUT || !pins[l.gate].out)) return false;
+	return true;
+}
+
+uint64_t hostSimNanos()
+{
+	return stats.time_ns;
+}
+
+static void runIsr(void (*vector)(void));
+static uint64_t timer1NextMatch();
+static void timer1Match();
+static uint64_t extIntNext(int *n);
+static void extIntEdge(int n, uint64_t at);
+
+static void integrate(uint64_t ns, host_mcu_t state)
+{
+	float mA = mcu_mA[state];
+	for (int i = 0; i < loadCount; i++) {
+		if (loadOn(loads[i])) {
+			mA += loads[i].mA;
+			stats.load_ns[i] += ns;
+		}
+	}
+	stats.charge_uAs += mA * 1000.0 * (ns / 1e9);
+	stats.mcu_ns[state] += ns;
+	stats.time_ns += ns;
+	if ((state == HOST_MCU_ACTIVE || state == HOST_MCU_IDLE) && timer0On) timer0_ns += ns;
+}
+
+void hostSimSpend(uint64_t ns, host_mcu_t state)
+{
+	if (state != HOST_MCU_ACTIVE && state != HOST_MCU_IDLE) {
+		// clkIO stopped, Timer1 holds its count, edges are not detected
+		integrate(ns, state);
+		t1Base += ns;
+		for (int n = 0; n < EXT_INTERRUPTS; n++) extInt[n].seen = stats.time_ns;
+		return;
+	}
+	// Timer1 compare matches and pin edges up to the end, in time order
+	uint64_t end = stats.time_ns + ns;
+	while (!inIsr) {
+		int n;
+		uint64_t match = timer1NextMatch();
+		uint64_t edge = extIntNext(&n);
+		uint64_t next = (match < edge) ? match : edge;
+		if (next > end) break;
+		if (next > stats.time_ns) integrate(next - stats.time_ns, state);
+		if (match <= edge) timer1Match();
+		else extIntEdge(n, edge);
+	}
+	if (end > stats.time_ns) integrate(end - stats.time_ns, state);
+}
+
+void hostSimSpendCycles(uint32_t cycles)
+{
+	hostSimSpend(cycles * NS_PER_CYCLE, HOST_MCU_ACTIVE);
+}
+
+void hostSimSetVcc(uint16_t millivolt)
+{
+	vcc_mV = millivolt;
+}
+
+void hostSimSetWdtScale(float scale)
+{
+	wdtScale = scale;
+}
+
+// The 128kHz watchdog oscillator of the ATmega328P runs ~12% slow at 3-5V
+// and gets slower as the chip warms up, the chip is at the air temperature
+float hostSimWdtScale()
+{
+	return wdtScale * 1.14 * (1.0 + 0.002 * (hostSimTemperature(hostSimNanos()) - 20.0));
+}
+
+void hostSimTimer0(bool on)
+{
+	timer0On = on;
+}
+
+void hostSimFail(const char *msg)
+{
+	fflush(stdout);
+	fprintf(stderr, "HostSim: %s (at %.3f s)\n", msg, stats.time_ns / 1e9);
+	exit(2);
+}
+
+void hostSimGetStats(HostSimStats *s)
+{
+	*s = stats;
+}
+
+int hostSimAttachLoad(const char *name, uint8_t pin, int8_t gatePin, float milliampere)
+{
+	if (loadCount >= HOST_SIM_MAX_LOADS) hostSimFail("too many loads");
+	loads[loadCount].name = name;
+	loads[loadCount].pin = pin;
+	loads[loadCount].gate = gatePin;
+	loads[loadCount].mA = milliampere;
+	return loadCount++;
+}
+
+const char *hostSimLoadName(int load)
+{
+	return (load < loadCount) ? loads[load].name : 0;
+}
+
+/////////////////////////////////////////////////////
+//
+// pins
+//
+
+static void pinChanged(uint8_t pin)
+{
+	for (uint8_t i = 0; i < MAX_LISTENERS; i++) {
+		if (pins[pin].listener[i]) pins[pin].listener[i](pin);
+	}
+}
+
+static void setPin(uint8_t pin, uint8_t mode, uint8_t out)
+{
+	if (pins[pin].mode == mode && pins[pin].out == out) return;
+	pins[pin].mode = mode;
+	pins[pin].out = out;
+	pinChanged(pin);
+}
+
+static int readPin(uint8_t pin)
+{
+	if (pins[pin].mode == OUTPUT) return pins[pin].out;
+	if (pins[pin].input) return pins[pin].input(pin);
+	return (pins[pin].mode == INPUT_PULLUP) ? HIGH : LOW;
+}
+
+uint8_t hostPinMode(uint8_t pin)
+{
+	return pins[pin].mode;
+}
+
+int8_t hostPinDrive(uint8_t pin)
+{
+	return (pins[pin].mode == OUTPUT) ? pins[pin].out : -1;
+}
+
+void hostPinListen(uint8_t pin, void (*changed)(uint8_t pin))
+{
+	for (uint8_t i = 0; i < MAX_LISTENERS; i++) {
+		if (!pins[pin].listener[i]) {
+			pins[pin].listener[i] = changed;
+			return;
+		}
+	}
+	hostSimFail("too many listeners on one pin");
+}
+
+void hostPinSetInput(uint8_t pin, int (*level)(uint8_t pin))
+{
+	pins[pin].input = level;
+}
+
+void hostPinSetEdges(uint8_t pin, uint64_t (*next)(uint8_t pin, uint64_t after))
+{
+	pins[pin].nextEdge = next;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	hostSimSpendCycles(CYCLES_PINMODE);
+	if (pin >= NUM_PINS) return;
+	// like wiring_digital.c: INPUT clears, INPUT_PULLUP sets the PORT bit
+	if (mode == INPUT) setPin(pin, INPUT, LOW);
+	else if (mode == INPUT_PULLUP) setPin(pin, INPUT_PULLUP, HIGH);
+	else setPin(pin, OUTPUT, pins[pin].out);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	hostSimSpendCycles(CYCLES_DIGITALWRITE);
+	if (pin >= NUM_PINS) return;
+	uint8_t mode = pins[pin].mode;
+	// writing the PORT bit of an input switches the pull up
+	if (mode != OUTPUT) mode = val ? INPUT_PULLUP : INPUT;
+	setPin(pin, mode, val ? HIGH : LOW);
+}
+
+int digitalRead(uint8_t pin)
+{
+	hostSimSpendCycles(CYCLES_DIGITALREAD);
+	if (pin >= NUM_PINS) return LOW;
+	return readPin(pin);
+}
+
+volatile uint8_t *hostPinToBaseReg(uint8_t pin)
+{
+	return &pinBase[pin];
+}
+
+static uint8_t basePin(volatile uint8_t *base)
+{
+	return (uint8_t)(base - pinBase);
+}
+
+static uint8_t directRead(uint8_t pin)
+{
+	return readPin(pin) ? 1 : 0;
+}
+
+static void directMode(uint8_t pin, uint8_t mode)
+{
+	if (mode == OUTPUT) setPin(pin, OUTPUT, pins[pin].out);
+	else setPin(pin, pins[pin].out ? INPUT_PULLUP : INPUT, pins[pin].out);
+}
+
+static void directWrite(uint8_t pin, uint8_t value)
+{
+	uint8_t mode = pins[pin].mode;
+	if (mode != OUTPUT) mode = value ? INPUT_PULLUP : INPUT;
+	setPin(pin, mode, value);
+}
+
+uint8_t hostDirectRead(volatile uint8_t *base)
+{
+	hostSimSpendCycles(CYCLES_DIRECT_IO);
+	return directRead(basePin(base));
+}
+
+void hostDirectMode(volatile uint8_t *base, uint8_t mode)
+{
+	hostSimSpendCycles(CYCLES_DIRECT_IO);
+	directMode(basePin(base), mode);
+}
+
+void hostDirectWrite(volatile uint8_t *base, uint8_t value)
+{
+	hostSimSpendCycles(CYCLES_DIRECT_IO);
+	directWrite(basePin(base), value);
+}
+
+/////////////////////////////////////////////////////
+//
+// time
+//
+
+unsigned long millis()
+{
+	hostSimSpendCycles(CYCLES_MICROS);
+	return (uint32_t)(timer0_ns / 1000000ULL);
+}
+
+unsigned long micros()
+{
+	hostSimSpendCycles(CYCLES_MICROS);
+	return (uint32_t)(timer0_ns / 1000ULL);
+}
+
+void delay(unsigned long ms)
+{
+	hostSimSpend(ms * 1000000ULL, HOST_MCU_ACTIVE);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	hostSimSpend(us * 1000ULL, HOST_MCU_ACTIVE);
+}
+
+/////////////////////////////////////////////////////
+//
+// external interrupts INT0/INT1, edges of the devices behind hostPinSetEdges()
+//
+
+static const uint8_t extIntPin[EXT_INTERRUPTS] = { 2, 3 };
+
+void attachInterrupt(uint8_t n, void (*handler)(void), int mode)
+{
+	hostSimSpendCycles(CYCLES_PINMODE);
+	if (n >= EXT_INTERRUPTS) return;
+	if (mode != CHANGE && mode != FALLING && mode != RISING) hostSimFail("attachInterrupt: only edges are modelled");
+	ExtInt &e = extInt[n];
+	e.handler = handler;
+	e.mode = mode;
+	e.level = readPin(extIntPin[n]);
+	e.seen = stats.time_ns;
+	e.pending = false;
+}
+
+void detachInterrupt(uint8_t n)
+{
+	hostSimSpendCycles(CYCLES_PINMODE);
+	if (n < EXT_INTERRUPTS) extInt[n].handler = 0;
+}
+
+static void extIntPending()
+{
+	if (!interruptsOn || inIsr) return;
+	for (int n = 0; n < EXT_INTERRUPTS; n++) {
+		if (extInt[n].pending && extInt[n].handler) {
+			extInt[n].pending = false;
+			hostSimSpendCycles(CYCLES_EXT_ISR);
+			runIsr(extInt[n].handler);
+		}
+	}
+}
+
+// next edge of an attached interrupt pin, UINT64_MAX if none
+static uint64_t extIntNext(int *n)
+{
+	uint64_t next = UINT64_MAX;
+	for (int i = 0; i < EXT_INTERRUPTS; i++) {
+		uint8_t pin = extIntPin[i];
+		if (!extInt[i].handler || !pins[pin].nextEdge || pins[pin].mode == OUTPUT) continue;
+		uint64_t at = pins[pin].nextEdge(pin, extInt[i].seen);
+		if (at < next) {
+			next = at;
+			*n = i;
+		}
+	}
+	return next;
+}
+
+// the pin of interrupt n changed at 'at', now is 'at' or later
+static void extIntEdge(int n, uint64_t at)
+{
+	ExtInt &e = extInt[n];
+	uint8_t level = readPin(extIntPin[n]);
+	e.seen = at;
+	if (level == e.level) return;
+	e.level = level;
+	if (e.mode == CHANGE || (e.mode == RISING) == (level == HIGH)) {
+		e.pending = true;
+		extIntPending();
+	}
+}
+
+/////////////////////////////////////////////////////
+//
+// interrupts, Timer1 and sleep_cpu()
+//
+
+static void runIsr(void (*vector)(void))
+{
+	isrCount++;
+	inIsr = true;
+	interruptsOn = false;
+	hostSimSpendCycles(CYCLES_ISR);
+	vector();
+	interruptsOn = true;
+	inIsr = false;
+}
+
+static void timer1Pending()
+{
+	if (!interruptsOn || inIsr) return;
+	if ((sfr[HOST_SFR_TIFR1] & _BV(OCF1A)) && (sfr[HOST_SFR_TIMSK1] & _BV(OCIE1A)) && TIMER1_COMPA_vect) {
+		sfr[HOST_SFR_TIFR1] &= ~_BV(OCF1A); // cleared when the vector is executed
+		runIsr(TIMER1_COMPA_vect);
+	}
+}
+
+void cli()
+{
+	interruptsOn = false;
+}
+
+void sei()
+{
+	interruptsOn = true;
+	timer1Pending();
+	extIntPending();
+}
+
+static uint64_t timer1TickNs()
+{
+	static const uint16_t prescaler[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+	uint8_t cs = sfr[HOST_SFR_TCCR1B] & 0x07;
+	if (cs >= 6) hostSimFail("Timer1 external clock not modelled");
+	return prescaler[cs] * NS_PER_CYCLE;
+}
+
+static bool timer1Ctc()
+{
+	return (sfr[HOST_SFR_TCCR1B] & _BV(WGM12)) && !(sfr[HOST_SFR_TCCR1B] & _BV(WGM13));
+}
+
+static uint16_t timer1Count()
+{
+	uint64_t tick = timer1TickNs();
+	if (!tick) return sfr[HOST_SFR_TCNT1];
+	uint64_t ticks = (stats.time_ns - t1Base) / tick;
+	return timer1Ctc() ? ticks % ((uint32_t)sfr[HOST_SFR_OCR1A] + 1) : ticks % 65536;
+}
+
+// next compare match in CTC mode, UINT64_MAX if the timer does not run
+static uint64_t timer1NextMatch()
+{
+	uint64_t tick = timer1TickNs();
+	if (!tick || !timer1Ctc()) return UINT64_MAX;
+	return t1Base + ((uint64_t)sfr[HOST_SFR_OCR1A] + 1) * tick;
+}
+
+// at the compare match: set OCF1A, run the ISR
+static void timer1Match()
+{
+	t1Base = timer1NextMatch();
+	sfr[HOST_SFR_TIFR1] |= _BV(OCF1A);
+	timer1Pending();
+}
+
+void set_sleep_mode(uint8_t mode)
+{
+	sleepMode = mode;
+}
+
+void sleep_enable()
+{
+	sleepEnabled = true;
+}
+
+void sleep_disable()
+{
+	sleepEnabled = false;
+}
+
+void sleep_cpu()
+{
+	hostSimSpendCycles(1);
+	if (!sleepEnabled) return;
+	host_mcu_t state;
+	if (sleepMode == SLEEP_MODE_IDLE) state = HOST_MCU_IDLE;
+	else if (sleepMode == SLEEP_MODE_ADC) state = HOST_MCU_ADCNR;
+	else {
+		hostSimFail("sleep_cpu: only idle and ADC noise reduction are modelled, see LowPower");
+		return;
+	}
+	// clkIO stops in ADC noise reduction, see hostSimAdcSleep() for that
+	if (state != HOST_MCU_IDLE || !interruptsOn) hostSimFail("sleep_cpu without a wake up source");
+	// idle ends with the next ISR: Timer1 compare A, an external interrupt
+	// or at the latest the timer0 overflow of millis()
+	uint32_t isrs = isrCount;
+	while (isrCount == isrs) {
+		int n;
+		uint64_t overflow = stats.time_ns + TIMER0_OVF_NS - timer0_ns % TIMER0_OVF_NS;
+		uint64_t wake = overflow;
+		uint64_t match = timer1NextMatch();
+		if ((sfr[HOST_SFR_TIMSK1] & _BV(OCIE1A)) && match < wake) wake = match;
+		uint64_t edge = extIntNext(&n);
+		if (edge < wake) wake = edge;
+		hostSimSpend(wake > stats.time_ns ? wake - stats.time_ns : 0, state);
+		if (wake == overflow && isrCount == isrs) {
+			hostSimSpendCycles(CYCLES_ISR);
+			break;
+		}
+	}
+}
+
+void HardwareSerial::hostWrite(const char *s, bool newline)
+{
+	printf(newline ? "%s\n" : "%s", s);
+}
+
+/////////////////////////////////////////////////////
+//
+// ADC, only the 1.1V bandgap against AVcc is wired up
+//
+
+static void adcConvert(host_mcu_t state)
+{
+	uint8_t prescaler = 1 << (sfr[HOST_SFR_ADCSRA] & 0x07);
+	if (prescaler < 2) prescaler = 2;
+	hostSimSpend((adcFirst ? 25ULL : 13ULL) * prescaler * NS_PER_CYCLE, state);
+	adcFirst = false;
+
+	uint16_t result = 0;
+	if ((sfr[HOST_SFR_ADMUX] & 0x0F) == 0x0E) {
+		// bandgap, +-1 LSB noise
+		noise = noise * 1103515245UL + 12345UL;
+		result = (uint16_t)((1100UL * 1024UL + vcc_mV / 2) / vcc_mV) + (int)((noise >> 16) % 3) - 1;
+	}
+	sfr[HOST_SFR_ADCL] = result & 0xFF;
+	sfr[HOST_SFR_ADCH] = result >> 8;
+	sfr[HOST_SFR_ADCSRA] = (sfr[HOST_SFR_ADCSRA] & ~_BV(ADSC)) | _BV(ADIF);
+}
+
+// entering ADC noise reduction starts a conversion, its interrupt ends the
+// sleep if enabled, otherwise the watchdog does after 'wdtNs'
+void hostSimAdcSleep(uint64_t wdtNs)
+{
+	uint64_t start = stats.time_ns;
+	if (sfr[HOST_SFR_ADCSRA] & _BV(ADEN)) {
+		adcConvert(HOST_MCU_ADCNR);
+		if ((sfr[HOST_SFR_ADCSRA] & _BV(ADIE)) && interruptsOn && ADC_vect) {
+			sfr[HOST_SFR_ADCSRA] &= ~_BV(ADIF); // cleared when the vector is executed
+			runIsr(ADC_vect);
+			return;
+		}
+	}
+	if (!wdtNs) hostSimFail("ADC noise reduction without a wake up source");
+	uint64_t spent = stats.time_ns - start;
+	if (wdtNs > spent) hostSimSpend(wdtNs - spent, HOST_MCU_ADCNR);
+}
+
+/////////////////////////////////////////////////////
+//
+// ports B, C, D: PIN, DDR and PORT registers of the pins, mapped like the
+// digital_pin_to_port_PGM and digital_pin_to_bit_mask_PGM tables of the
+// standard variant (0-7 PORTD, 8-13 PORTB, 14-19 PORTC)
+//
+
+enum { PORT_B, PORT_C, PORT_D };
+
+static const uint8_t pinPort[NUM_PINS] = {
+	PORT_D, PORT_D, PORT_D, PORT_D, PORT_D, PORT_D, PORT_D, PORT_D,
+	PORT_B, PORT_B, PORT_B, PORT_B, PORT_B, PORT_B,
+	PORT_C, PORT_C, PORT_C, PORT_C, PORT_C, PORT_C
+};
+
+static const uint8_t pinBitMask[NUM_PINS] = {
+	_BV(0), _BV(1), _BV(2), _BV(3), _BV(4), _BV(5), _BV(6), _BV(7),
+	_BV(0), _BV(1), _BV(2), _BV(3), _BV(4), _BV(5),
+	_BV(0), _BV(1), _BV(2), _BV(3), _BV(4), _BV(5)
+};
+
+static bool isPortSfr(uint8_t id)
+{
+	return id >= HOST_SFR_PINB && id <= HOST_SFR_PORTD;
+}
+
+// id - HOST_SFR_PINB: port * 3 + 0 PIN, 1 DDR, 2 PORT
+static uint8_t portRead(uint8_t id)
+{
+	uint8_t port = (id - HOST_SFR_PINB) / 3, reg = (id - HOST_SFR_PINB) % 3;
+	uint8_t value = 0;
+	for (uint8_t pin = 0; pin < NUM_PINS; pin++) {
+		if (pinPort[pin] != port) continue;
+		bool set = (reg == 0) ? readPin(pin) : (reg == 1) ? pins[pin].mode == OUTPUT : pins[pin].out;
+		if (set) value |= pinBitMask[pin];
+	}
+	return value;
+}
+
+static void portWrite(uint8_t id, uint8_t value)
+{
+	uint8_t port = (id - HOST_SFR_PINB) / 3, reg = (id - HOST_SFR_PINB) % 3;
+	if (reg == 0) hostSimFail("writing PINx (toggle) is not modelled");
+	for (uint8_t pin = 0; pin < NUM_PINS; pin++) {
+		if (pinPort[pin] != port) continue;
+		uint8_t set = (value & pinBitMask[pin]) ? 1 : 0;
+		if (reg == 1) directMode(pin, set ? OUTPUT : INPUT);
+		else directWrite(pin, set);
+	}
+}
+
+uint16_t hostSfrRead(uint8_t id)
+{
+	hostSimSpendCycles(1);
+	if (id == HOST_SFR_TCNT1) return timer1Count();
+	if (isPortSfr(id)) return portRead(id);
+	return sfr[id];
+}
+
+void hostSfrWrite(uint8_t id, uint16_t value)
+{
+	hostSimSpendCycles(1);
+	if (isPortSfr(id)) {
+		portWrite(id, (uint8_t)value);
+		return;
+	}
+	if (id == HOST_SFR_ADCSRA) {
+		if (!(value & _BV(ADEN))) adcFirst = true;
+		// writing ADIF clears it
+		value = (value & ~_BV(ADIF)) | (sfr[id] & _BV(ADIF) & ~value);
+		sfr[id] = (uint8_t)value;
+		if ((value & _BV(ADEN)) && (value & _BV(ADSC))) adcConvert(HOST_MCU_ACTIVE);
+		return;
+	}
+	if (id == HOST_SFR_ADCL || id == HOST_SFR_ADCH) return; // read only
+	if (id == HOST_SFR_TCNT1) {
+		sfr[id] = value;
+		if (timer1TickNs()) t1Base = stats.time_ns - value * timer1TickNs();
+		return;
+	}
+	if (id == HOST_SFR_OCR1A) {
+		sfr[id] = value; // the counter keeps running, a new TOP applies to the current period
+		return;
+	}
+	if (id == HOST_SFR_TCCR1B) {
+		sfr[HOST_SFR_TCNT1] = timer1Count(); // freeze or resume at the current count
+		sfr[id] = (uint8_t)value;
+		if (timer1TickNs()) t1Base = stats.time_ns - sfr[HOST_SFR_TCNT1] * timer1TickNs();
+		return;
+	}
+	if (id == HOST_SFR_TIFR1) {
+		sfr[id] &= ~value; // writing a one clears the flag
+		return;
+	}
+	sfr[id] = (uint8_t)value;
+	if (id == HOST_SFR_TIMSK1) timer1Pending();
+}
+
+/////////////////////////////////////////////////////
+//
+// EEPROM
+//
+
+static uint16_t eeAddress(const void *p, size_t n)
+{
+	uintptr_t a = (uintptr_t)p;
+	if (!eepromInit) {
+		memset(eeprom, 0xFF, sizeof(eeprom)); // erased chip
+		eepromInit = true;
+	}
+	if (a + n > E2END + 1) hostSimFail("EEPROM access out of range");
+	return (uint16_t)a;
+}
+
+// after a power cut nothing is programmed any more, the byte that was being
+// programmed is left erased
+void hostSimEepromCut(int32_t bytes)
+{
+	eeCut = bytes;
+}
+
+static void eeProgram(uint16_t a, uint8_t value)
+{
+	if (eeCut == 0) return;
+	if (eeCut > 0 && --eeCut == 0) value = 0xFF;
+	eeprom[a] = value;
+	stats.ee_bytes_written++;
+	hostSimSpend(EEPROM_WRITE_NS, HOST_MCU_ACTIVE);
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+	uint16_t a = eeAddress(src, n);
+	hostSimSpendCycles(CYCLES_EEPROM_READ * n);
+	memcpy(dst, &eeprom[a], n);
+}
+
+void eeprom_write_block(const void *src, void *dst, size_t n)
+{
+	uint16_t a = eeAddress(dst, n);
+	for (size_t i = 0; i < n; i++) eeProgram(a + i, ((const uint8_t *)src)[i]);
+}
+
+void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+	uint16_t a = eeAddress(dst, n);
+	for (size_t i = 0; i < n; i++) {
+		hostSimSpendCycles(CYCLES_EEPROM_READ);
+		if (eeprom[a + i] != ((const uint8_t *)src)[i]) eeProgram(a + i, ((const uint8_t *)src)[i]);
+	}
+}
+
+uint8_t eeprom_read_byte(const uint8_t *p) { uint8_t v; eeprom_read_block(&v, p, sizeof(v)); return v; }
+uint16_t eeprom_read_word(const uint16_t *p) { uint16_t v; eeprom_read_block(&v, p, sizeof(v)); return v; }
+uint32_t eeprom_read_dword(const uint32_t *p) { uint32_t v; eeprom_read_block(&v, p, sizeof(v)); return v; }
+float eeprom_read_float(const float *p) { float v; eeprom_read_block(&v, p, sizeof(v)); return v; }
+
+void eeprom_write_byte(uint8_t *p, uint8_t v) { eeprom_write_block(&v, p, sizeof(v)); }
+void eeprom_write_word(uint16_t *p, uint16_t v) { eeprom_write_block(&v, p, sizeof(v)); }
+void eeprom_write_dword(uint32_t *p, uint32_t v) { eeprom_write_block(&v, p, sizeof(v)); }
+void eeprom_write_float(float *p, float v) { eeprom_write_block(&v, p, sizeof(v)); }
+
+void eeprom_update_byte(uint8_t *p, uint8_t v) { eeprom_update_block(&v, p, sizeof(v)); }
+void eeprom_update_word(uint16_t *p, uint16_t v) { eeprom_update_block(&v, p, sizeof(v)); }
+void eeprom_update_dword(uint32_t *p, uint32_t v) { eeprom_update_block(&v, p, sizeof(v)); }
+void eeprom_update_float(float *p, float v) { eeprom_update_block(&v, p, sizeof(v)); }
+
+/////////////////////////////////////////////////////
+//
+// start up, like init() of wiring.c
+//
+
+void hostSimInit()
+{
+	for (uint8_t i = 0; i < NUM_PINS; i++) {
+		pins[i].mode = INPUT;
+		pins[i].out = LOW;
+	}
+	sfr[HOST_SFR_ADCSRA] = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1); // 125kHz ADC clock at 8MHz
+	sfr[HOST_SFR_MCUSR] = _BV(PORF);
+}
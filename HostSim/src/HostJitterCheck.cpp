@@ -0,0 +1,68 @@
+/*
+  HostJitterCheck.cpp - slots of nodes that wake in lockstep
+
+  The worst case of WakeJitter: NODES nodes were powered up together and
+  their calibrated watchdogs keep them in lockstep, every node sends in every
+  wake, with a burst shorter than a slot. The nodes only differ in the seed,
+  ids 0, 1, 2, ..., the noise of the ADC and of the calibration is left out.
+
+  A burst is lost if another node picked the same slot. For random slots that
+  happens with 1 - (1 - 1/slots)^(nodes - 1), without the jitter always. The
+  check fails if more bursts are lost than that allows, or if a pair of nodes
+  meets much more often than 1 in 'slots' wakes: their slots follow each other.
+*/
+
+#include <Arduino.h>
+#include <HostSim.h>
+#include <WakeScheduler.h>
+#include <math.h>
+
+#define CHECK_NODES     32
+#define CHECK_WAKES     4000
+
+static int checkNodes(int nodes, int slots)
+{
+	WakeJitter jitter[CHECK_NODES];
+	uint16_t met[CHECK_NODES][CHECK_NODES];
+	memset(met, 0, sizeof(met));
+	for (int i = 0; i < nodes; i++) jitter[i].begin(slots, 1000, i);
+
+	uint32_t lost = 0;
+	for (int w = 0; w < CHECK_WAKES; w++) {
+		for (int i = 0; i < nodes; i++) jitter[i].next();
+		for (int i = 0; i < nodes; i++) {
+			bool collided = false;
+			for (int j = 0; j < nodes; j++) {
+				if (j == i || jitter[j].slot() != jitter[i].slot()) continue;
+				collided = true;
+				if (j > i) met[i][j]++;
+			}
+			if (collided) lost++;
+		}
+	}
+
+	int wrong = 0;
+	double expected = 1 - pow(1 - 1.0 / slots, nodes - 1);
+	double measured = (double)lost / nodes / CHECK_WAKES;
+	if (measured > expected * 1.1 + 0.005) wrong++;
+	uint16_t worst = 0;
+	for (int i = 0; i < nodes; i++) {
+		for (int j = i + 1; j < nodes; j++) worst = max(worst, met[i][j]);
+	}
+	// a pair in lockstep meets in every wake, random slots in 1 of 'slots'
+	if (worst > 2 * CHECK_WAKES / slots) wrong++;
+	printf("jitter: %2d nodes in %d slots, %5.1f%% of the bursts lost (%.1f%% expected, 100%% without), a pair met in %u of %u wakes at most\n",
+		   nodes, slots, 100 * measured, 100 * expected, worst, CHECK_WAKES);
+	return wrong;
+}
+
+int hostJitterCheck(int slots)
+{
+	if (slots < 2) {
+		printf("jitter: off, nodes in lockstep lose every burst\n");
+		return 0;
+	}
+	int wrong = 0;
+	for (int nodes = 2; nodes <= CHECK_NODES; nodes *= 2) wrong += checkNodes(nodes, slots);
+	return wrong;
+}
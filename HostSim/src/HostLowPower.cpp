@@ -0,0 +1,78 @@
+/*
+  HostLowPower.cpp - LowPower library of the host simulator
+
+  The sleep modes only differ in the MCU current and in whether timer0 keeps
+  counting (idle) or stops (all other modes), like on the ATmega328P. Wake up
+  is by the watchdog: 2K << period cycles of the 128kHz oscillator, stretched
+  by the watchdog scale to model its drift. Power-down and power-save stop
+  the clock source, it starts up again before the CPU runs. ADC noise reduction also starts a
+  conversion and wakes up on the ADC interrupt. Idle with TIMER0_OFF stops
+  millis(), there is no timer0 interrupt to wake up early then.
+*/
+
+#include <Arduino.h>
+#include <LowPower.h>
+#include <HostSim.h>
+
+// wake up from sleep, 4 CK halted, the interrupt response and the WDT ISR
+#define CYCLES_WAKEUP 60
+// start-up of the low power crystal oscillator of the LilyPad after power-down,
+// low fuse 0xFF: CKSEL0 = 1 and SUT = 11, 16K CK
+#define CYCLES_STARTUP 16384
+
+LowPowerClass LowPower;
+
+static uint64_t wdtPeriodNs(period_t period)
+{
+	if (period == SLEEP_FOREVER) hostSimFail("SLEEP_FOREVER without a wake up source");
+	return (uint64_t)((2048ULL << period) * (1e9 / 128000.0) * hostSimWdtScale());
+}
+
+static void sleepFor(period_t period, adc_t adc, host_mcu_t state)
+{
+	uint16_t adcsra = ADCSRA;
+	if (adc == ADC_OFF) ADCSRA = adcsra & ~_BV(ADEN);
+	hostSimSpend(wdtPeriodNs(period), state);
+	if (state == HOST_MCU_POWERDOWN) hostSimSpend(CYCLES_STARTUP * (1000000000ULL / F_CPU), HOST_MCU_STARTUP);
+	hostSimSpendCycles(CYCLES_WAKEUP);
+	if (adc == ADC_OFF) ADCSRA = adcsra;
+}
+
+void LowPowerClass::idle(period_t period, adc_t adc, timer2_t timer2,
+						 timer1_t timer1, timer0_t timer0, spi_t spi,
+						 usart0_t usart0, twi_t twi)
+{
+	if (timer0 == TIMER0_ON) hostSimFail("idle with timer0: its interrupt ends the sleep, not modelled");
+	hostSimTimer0(false);
+	sleepFor(period, adc, HOST_MCU_IDLE);
+	hostSimTimer0(true);
+}
+
+void LowPowerClass::adcNoiseReduction(period_t period, adc_t adc, timer2_t timer2)
+{
+	uint16_t adcsra = ADCSRA;
+	if (adc == ADC_OFF) ADCSRA = adcsra & ~_BV(ADEN);
+	hostSimAdcSleep(period == SLEEP_FOREVER ? 0 : wdtPeriodNs(period));
+	hostSimSpendCycles(CYCLES_WAKEUP);
+	if (adc == ADC_OFF) ADCSRA = adcsra;
+}
+
+void LowPowerClass::powerDown(period_t period, adc_t adc, bod_t bod)
+{
+	sleepFor(period, adc, HOST_MCU_POWERDOWN);
+}
+
+void LowPowerClass::powerSave(period_t period, adc_t adc, bod_t bod, timer2_t timer2)
+{
+	sleepFor(period, adc, HOST_MCU_POWERDOWN);
+}
+
+void LowPowerClass::powerStandby(period_t period, adc_t adc, bod_t bod)
+{
+	sleepFor(period, adc, HOST_MCU_STARTUP); // the oscillator keeps running
+}
+
+void LowPowerClass::powerExtStandby(period_t period, adc_t adc, bod_t bod, timer2_t timer2)
+{
+	sleepFor(period, adc, HOST_MCU_STARTUP);
+}
@@ -0,0 +1,333 @@
+/*
+  HostMain.cpp - runs the firmware for a number of wake cycles
+
+  One cycle is one call of loop(): measure, send, sleep. For every cycle the
+  awake time, the on-time of the loads, the consumed charge and the frames
+  the gateway received are printed, followed by the averages over all cycles.
+
+  Bench mode (-b) prints only the averages as "<location> <metric> <value>"
+  lines, the format of bench/baseline. With -c the averages are checked
+  against such a file and the exit code is 1 if any metric got worse, or
+  better by more than its tolerance: the baseline is out of date then and
+  would hide a later regression of the same size.
+
+  -g only checks FastPin against the ArduinoCore pin API, see HostGpioCheck.cpp.
+  -e only checks EELog through power cuts, see HostEepromCheck.cpp.
+
+  -l prints the EventLog dump of the node after the last cycle, for
+  build/evdecode.
+
+  -f n lets the DHT22 ignore every n-th start signal to see the cost of the
+  retries, -f 1 is a DHT22 that never answers.
+
+  -d n lets the n-th DS18B20 of the pond stop answering from the start.
+
+  -w bytes fails (exit code 1) if the cycles program more EEPROM bytes than
+  that, e.g. -f 1 -w 7: a broken sensor spills one fault, not one per wake.
+  The bytes copied to the EEPROM of the DS18B20s count as well.
+
+  -t ppm fails if WakeScheduler::clockSeconds() is further off the simulated
+  time since power on than that after the cycles, it has to make up for the
+  drift of the watchdog.
+
+  The timing of every OneWire slot is checked against the DS18B20 datasheet,
+  ow_slot_err counts the violations.
+
+  The accuracy of the reports is the mean difference between the last value
+  the gateway received and the true value, taken at the end of every cycle.
+
+  The interval error is the mean difference between the length of a cycle
+  and the interval the sketch aimed at (SleepTimer and the slot of the next
+  wake), the watchdog drifts with temperature, see hostSimWdtScale().
+
+  usage: sim_<location> [-n cycles] [-v] [-f n] [-d n] [-b] [-c baseline] [-g] [-e] [-j] [-l] [-w bytes] [-t ppm]
+*/
+
+#include <Arduino.h>
+#include <HostSim.h>
+#include <TelemetryFrame.h>
+#include <EventLog.h>
+#include <unistd.h>
+
+#define NS_PER_MS 1e6
+
+// 4 AA alkaline cells in series
+#define BATTERY_uAh 2500000.0
+
+enum metric_t
+{
+	METRIC_AWAKE,       // MCU not in power-down
+	METRIC_TX,          // transmitter powered
+	METRIC_TX_IDLE,     // transmitter powered before its first carrier pulse
+	METRIC_AIRTIME,     // carrier on
+	METRIC_SENSOR,      // sensor powered
+	METRIC_CHARGE,      // uAh per cycle
+	METRIC_LIFE,        // days on BATTERY_uAh
+	METRIC_EDGE,        // worst deviation of a carrier edge from the protocol timing
+	METRIC_REPORT,      // mean error of the values known to the gateway
+	METRIC_ONEWIRE,     // OneWire slots outside the datasheet timing
+	METRIC_INTERVAL,    // mean deviation of the wake interval from SleepTimer and the slot
+	METRICS
+};
+
+// a metric may get 'tolerance' worse before the check fails, relative
+// to the baseline value if 'relative'
+static const struct
+{
+	const char *name;
+	bool higherIsBetter;
+	double tolerance;
+	bool relative;
+} metric[METRICS] = {
+	{ "awake_ms",   false, 0.5,   false },
+	{ "tx_ms",      false, 0.5,   false },
+	{ "tx_idle_ms", false, 0.5,   false },
+	{ "airtime_ms", false, 0.5,   false },
+	{ "sensor_ms",  false, 0.5,   false },
+	{ "uAh",        false, 0.002, true  },
+	{ "life_days",  true,  0.002, true  },
+	{ "edge_err_us", false, 1.0,  false },
+	{ "report_err", false, 0.005, false },
+	{ "ow_slot_err", false, 0.0,  false },
+	{ "interval_err_s", false, 0.5, false },
+};
+
+// sum of the deviations of the cycles from the wake interval
+static struct
+{
+	double errorSum;
+	uint32_t cycles;
+} interval;
+
+// last values the gateway received, and the sum of their errors so far
+static struct
+{
+	double value[TELEMETRY_VALUES];
+	bool known[TELEMETRY_VALUES];
+	double errorSum;
+	uint32_t samples;
+} gateway;
+
+static void gatewayUpdate()
+{
+	for (int i = 0; i < hostSimRadioFrameCount(); i++) {
+		const HostRadioFrame *f = hostSimRadioFrame(i);
+		TelemetryData t;
+		if (f->bits != TELEMETRY_FRAME_BITS || !TelemetryFrame::decode(f->data, &t)) continue;
+		for (int v = 0; v < TELEMETRY_VALUES; v++) {
+			if (t.value[v] == TELEMETRY_NO_VALUE || t.value[v] == TELEMETRY_ERROR) continue;
+			gateway.value[v] = t.value[v] / 10.0;
+			gateway.known[v] = true;
+		}
+	}
+	for (int v = 0; v < TELEMETRY_VALUES; v++) {
+		if (!gateway.known[v]) continue;
+		gateway.errorSum += fabs(gateway.value[v] - hostSketchTruth(v, hostSimNanos()));
+		gateway.samples++;
+	}
+}
+
+static double awakeNs(const HostSimStats &s)
+{
+	return s.mcu_ns[HOST_MCU_ACTIVE] + s.mcu_ns[HOST_MCU_IDLE] + s.mcu_ns[HOST_MCU_ADCNR];
+}
+
+static void printFrames()
+{
+	for (int i = 0; i < hostSimRadioFrameCount(); i++) {
+		const HostRadioFrame *f = hostSimRadioFrame(i);
+		printf("    frame %3u bit x%-2u ", f->bits, f->repeats);
+		for (int b = 0; b < (f->bits + 7) / 8; b++) printf("%02X", f->data[b]);
+		if (f->bits <= 32) {
+			unsigned long v = 0;
+			for (int b = 0; b < f->bits; b++) v = (v << 1) | ((f->data[b / 8] >> (7 - b % 8)) & 1);
+			printf("  (%lu)", v);
+		}
+		TelemetryData t;
+		if (f->bits == TELEMETRY_FRAME_BITS && TelemetryFrame::decode(f->data, &t)) {
+			printf("  node %u seq %2u %4u mV", t.node, t.seq, t.millivolt);
+			for (int i = 0; i < TELEMETRY_VALUES; i++) {
+				if (t.value[i] == TELEMETRY_NO_VALUE) printf("      -");
+				else if (t.value[i] == TELEMETRY_ERROR) printf("  error");
+				else printf(" %6.1f", t.value[i] / 10.0);
+			}
+		}
+		printf("\n");
+	}
+}
+
+// averages per cycle between two snapshots, radio idle time since 'idleFrom'
+static void metrics(const HostSimStats &from, const HostSimStats &to, uint64_t idleFrom, int cycles, double *m)
+{
+	int txLoad = 1, keyLoad = 2, sensorLoad = 3; // order of hostSketchWire()
+	double seconds = (to.time_ns - from.time_ns) / 1e9;
+	double charge = to.charge_uAs - from.charge_uAs;
+	m[METRIC_AWAKE] = (awakeNs(to) - awakeNs(from)) / NS_PER_MS / cycles;
+	m[METRIC_TX] = (to.load_ns[txLoad] - from.load_ns[txLoad]) / NS_PER_MS / cycles;
+	m[METRIC_TX_IDLE] = (hostSimRadioIdleNs() - idleFrom) / NS_PER_MS / cycles;
+	m[METRIC_AIRTIME] = (to.load_ns[keyLoad] - from.load_ns[keyLoad]) / NS_PER_MS / cycles;
+	m[METRIC_SENSOR] = (to.load_ns[sensorLoad] - from.load_ns[sensorLoad]) / NS_PER_MS / cycles;
+	m[METRIC_CHARGE] = charge / 3600.0 / cycles;
+	m[METRIC_LIFE] = BATTERY_uAh / (charge / seconds) / 24.0;
+	uint32_t pulses;
+	uint64_t maxErrorNs;
+	hostSimRadioTiming(&pulses, &maxErrorNs);
+	m[METRIC_EDGE] = maxErrorNs / 1000.0;
+	m[METRIC_REPORT] = gateway.samples ? gateway.errorSum / gateway.samples : 0;
+	uint32_t slots, violations;
+	hostSimOneWireTiming(&slots, &violations);
+	m[METRIC_ONEWIRE] = violations;
+	m[METRIC_INTERVAL] = interval.cycles ? interval.errorSum / interval.cycles : 0;
+}
+
+// returns the number of regressions and stale values, -1 if the baseline can not be read
+static int checkBaseline(const char *path, const double *m)
+{
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "%s: can not open baseline\n", path);
+		return -1;
+	}
+	char line[128], profile[32], name[32];
+	double base;
+	int found = 0, worse = 0;
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' || sscanf(line, "%31s %31s %lf", profile, name, &base) != 3) continue;
+		if (strcmp(profile, hostSketchProfile())) continue;
+		for (int i = 0; i < METRICS; i++) {
+			if (strcmp(name, metric[i].name)) continue;
+			found++;
+			double diff = metric[i].higherIsBetter ? base - m[i] : m[i] - base;
+			double allowed = metric[i].relative ? base * metric[i].tolerance : metric[i].tolerance;
+			const char *verdict = "ok";
+			if (diff > allowed) {
+				verdict = "REGRESSION";
+				worse++;
+			} else if (-diff > allowed) {
+				verdict = "STALE, improved: make rebaseline";
+				worse++;
+			}
+			printf("%-10s %-10s %12.3f  baseline %12.3f  %s\n", hostSketchProfile(), name, m[i], base, verdict);
+		}
+	}
+	fclose(f);
+	if (found != METRICS) {
+		fprintf(stderr, "%s: no complete baseline for %s\n", path, hostSketchProfile());
+		return -1;
+	}
+	return worse;
+}
+
+int main(int argc, char **argv)
+{
+	int cycles = 10;
+	bool verbose = false;
+	bool bench = false;
+	const char *baseline = 0;
+	bool gpio = false;
+	bool eelog = false;
+	bool jitter = false;
+	bool events = false;
+	int eeBytes = -1;
+	int clockPpm = -1;
+	int deadDs = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:vf:d:bc:gejlw:t:")) != -1) {
+		switch (opt) {
+			case 'n': cycles = atoi(optarg); break;
+			case 'v': verbose = true; break;
+			case 'f': hostSimDht22Flaky(atoi(optarg)); break;
+			case 'd': deadDs = atoi(optarg); break;
+			case 'b': bench = true; break;
+			case 'c': baseline = optarg; break;
+			case 'g': gpio = true; break;
+			case 'e': eelog = true; break;
+			case 'j': jitter = true; break;
+			case 'l': events = true; break;
+			case 'w': eeBytes = atoi(optarg); break;
+			case 't': clockPpm = atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-n cycles] [-v] [-f n] [-d n] [-b] [-c baseline] [-g] [-e] [-j] [-l] [-w bytes] [-t ppm]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (cycles < 1) cycles = 1;
+	bool quiet = bench || baseline || eeBytes >= 0 || clockPpm >= 0;
+
+	hostSimInit();
+	if (gpio) return hostGpioCheck() ? 1 : 0;
+	if (eelog) return hostEepromCheck() ? 1 : 0;
+	if (jitter) return hostJitterCheck(hostSketchSlots()) ? 1 : 0;
+	hostSketchWire();
+	if (deadDs) hostSimDs18b20Dead(deadDs);
+	setup();
+
+	HostSimStats first, before, after;
+	hostSimGetStats(&first);
+	uint32_t firstCopies = hostSimDs18b20Copies();
+	if (!quiet) {
+		printf("%s: setup %.1f ms, %.3f uAh\n", hostSketchProfile(),
+			   first.time_ns / NS_PER_MS, first.charge_uAs / 3600.0);
+		printf("cycle  awake ms   tx ms  key ms  sensor ms  sleep s      uAh  frames\n");
+	}
+
+	uint32_t received = hostSimRadioReceived();
+	uint64_t firstIdle = hostSimRadioIdleNs();
+	for (int c = 1; c <= cycles; c++) {
+		hostSimRadioClear();
+		hostSimGetStats(&before);
+		uint64_t idle = hostSimRadioIdleNs();
+		loop();
+		gatewayUpdate();
+		hostSimGetStats(&after);
+		interval.errorSum += fabs((after.time_ns - before.time_ns) / 1e9 - hostSketchInterval());
+		interval.cycles++;
+		uint32_t frames = hostSimRadioReceived() - received;
+		received += frames;
+		if (quiet) continue;
+		double m[METRICS];
+		metrics(before, after, idle, 1, m);
+		printf("%5d %9.1f %7.1f %7.1f %10.1f %8.1f %8.3f %7u\n", c,
+			   m[METRIC_AWAKE], m[METRIC_TX], m[METRIC_AIRTIME], m[METRIC_SENSOR],
+			   (after.mcu_ns[HOST_MCU_POWERDOWN] - before.mcu_ns[HOST_MCU_POWERDOWN]) / 1e9,
+			   m[METRIC_CHARGE], frames);
+		if (verbose) printFrames();
+	}
+
+	double m[METRICS];
+	metrics(first, after, firstIdle, cycles, m);
+	if (events) eventLog.dump(Serial);
+	if (eeBytes >= 0) {
+		uint32_t sensor = (hostSimDs18b20Copies() - firstCopies) * 3;
+		uint32_t written = after.ee_bytes_written - first.ee_bytes_written + sensor;
+		printf("eeprom: %d cycles, %u bytes written (%u in the DS18B20s), %d allowed\n", cycles, written, sensor, eeBytes);
+		return written > (uint32_t)eeBytes ? 1 : 0;
+	}
+	if (clockPpm >= 0) {
+		double s = after.time_ns / 1e9;
+		double ppm = fabs(hostSketchClockSeconds() - s) / s * 1e6;
+		printf("clock: %d cycles, the node counts %lu s of %.1f s, %.0f ppm off, %d allowed\n",
+			   cycles, hostSketchClockSeconds(), s, ppm, clockPpm);
+		return ppm > clockPpm ? 1 : 0;
+	}
+	if (baseline) {
+		int worse = checkBaseline(baseline, m);
+		return worse ? 1 : 0;
+	}
+	if (bench) {
+		for (int i = 0; i < METRICS; i++) printf("%s %s %.3f\n", hostSketchProfile(), metric[i].name, m[i]);
+		return 0;
+	}
+	printf("average: awake %.1f ms, tx %.1f ms (%.1f ms idle), airtime %.1f ms, sensor %.1f ms, %.3f uAh per cycle\n",
+		   m[METRIC_AWAKE], m[METRIC_TX], m[METRIC_TX_IDLE], m[METRIC_AIRTIME], m[METRIC_SENSOR], m[METRIC_CHARGE]);
+	printf("radio: worst edge %.1f us off the protocol timing\n", m[METRIC_EDGE]);
+	printf("reports: the gateway is %.3f off the true values on average\n", m[METRIC_REPORT]);
+	printf("interval: the wakes are %.3f s off SleepTimer on average\n", m[METRIC_INTERVAL]);
+	printf("clock: the node counts %lu s, %.1f s since power on\n", hostSketchClockSeconds(), after.time_ns / 1e9);
+	uint32_t slots, violations;
+	hostSimOneWireTiming(&slots, &violations);
+	if (slots) printf("onewire: %u slots, %u outside the datasheet timing\n", slots, violations);
+	printf("battery: %.2f uA average, %.0f days on 4xAA, %u EEPROM bytes written\n",
+		   BATTERY_uAh / 24.0 / m[METRIC_LIFE], m[METRIC_LIFE], after.ee_bytes_written - first.ee_bytes_written);
+	return 0;
+}
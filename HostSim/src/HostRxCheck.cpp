@@ -0,0 +1,102 @@
+/*
+  HostRxCheck.cpp - RCSwitch receiver against bursts of the longest lengths
+
+  The firmware of the nodes only sends, so the receiver is built into its own
+  binary, with RCSwitch compiled without RCSwitchDisableReceiving (see
+  Makefile). A burst of edges is put on the pin of INT0, repeated with the
+  gap in between until handleInterrupt() decodes it.
+
+  - a frame of RCSWITCH_MAX_BITS bits in protocol 1 is received bit for bit
+  - a burst of one bit pair more, RCSWITCH_MAX_CHANGES changes between the
+    gaps, is the longest handleInterrupt() passes on: it is rejected, before
+    it was decoded past the end of the bit buffer
+
+  usage: rxcheck              exit code 1 if a check failed
+*/
+
+#include <Arduino.h>
+#include <HostSim.h>
+#include <RCSwitch.h>
+
+#define RX_PIN          2           // INT0
+#define RX_PULSE_US     350         // protocol 1
+#define RX_GAP_US       (31 * RX_PULSE_US)
+#define RX_REPEATS      4
+#define RX_MAX_EDGES    (RX_REPEATS * (RCSWITCH_MAX_CHANGES + 1) + 1)
+
+static struct
+{
+	uint64_t at[RX_MAX_EDGES];      // level changes, the pin is low before the first
+	int count;
+} burst;
+
+static int rxLevel(uint8_t pin)
+{
+	uint64_t now = hostSimNanos();
+	int level = LOW;
+	for (int i = 0; i < burst.count && burst.at[i] <= now; i++) level = !level;
+	return level;
+}
+
+static uint64_t rxNextEdge(uint8_t pin, uint64_t after)
+{
+	for (int i = 0; i < burst.count; i++) {
+		if (burst.at[i] > after) return burst.at[i];
+	}
+	return UINT64_MAX;
+}
+
+static void edge(uint64_t *t, unsigned int us)
+{
+	*t += us * 1000ULL;
+	if (burst.count < RX_MAX_EDGES) burst.at[burst.count++] = *t;
+}
+
+// 'pairs' high/low pairs of 'bits' and the sync pulse if 'sync', repeated with the gap in between
+static void makeBurst(const uint8_t *bits, int pairs, bool sync)
+{
+	uint64_t t = hostSimNanos() + 1000000ULL;
+	burst.count = 0;
+	edge(&t, 0);
+	for (int r = 0; r < RX_REPEATS; r++) {
+		for (int i = 0; i < pairs; i++) {
+			bool one = bits[i / 8] & (0x80 >> (i % 8));
+			edge(&t, (one ? 3 : 1) * RX_PULSE_US);
+			edge(&t, (one ? 1 : 3) * RX_PULSE_US);
+		}
+		if (sync) edge(&t, RX_PULSE_US);
+		edge(&t, RX_GAP_US);
+	}
+}
+
+static int receive(RCSwitch &rx, const uint8_t *bits, int pairs, bool sync)
+{
+	rx.resetAvailable();
+	makeBurst(bits, pairs, sync);
+	delay((burst.at[burst.count - 1] - hostSimNanos()) / 1000000ULL + 1);
+	return rx.available() ? rx.getReceivedBitlength() : 0;
+}
+
+int main()
+{
+	RCSwitch rx;
+	uint8_t bits[(RCSWITCH_MAX_BITS + 8) / 8];
+	int failed = 0;
+
+	hostSimInit();
+	for (unsigned int i = 0; i < sizeof(bits); i++) bits[i] = 0xA5 ^ (i * 0x1D);
+	hostPinSetInput(RX_PIN, rxLevel);
+	hostPinSetEdges(RX_PIN, rxNextEdge);
+	rx.enableReceive(0);
+
+	int got = receive(rx, bits, RCSWITCH_MAX_BITS, true);
+	bool same = got == RCSWITCH_MAX_BITS && memcmp(rx.getReceivedBits(), bits, RCSWITCH_MAX_BITS / 8) == 0;
+	printf("rx: %d bit frame, %d bits received%s\n", RCSWITCH_MAX_BITS, got, same ? "" : ", wrong");
+	if (!same) failed++;
+
+	got = receive(rx, bits, RCSWITCH_MAX_BITS + 1, false);
+	printf("rx: %d changes between the gaps, %d bits received, 0 allowed\n", RCSWITCH_MAX_CHANGES, got);
+	if (got) failed++;
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+/*
+  HostSketch.cpp - the firmware as seen by the host simulator
+
+  Sketch.cpp is compiled as part of this file, once per sensor location
+  (-DSensor_xxx, see Makefile). ConfigData.h defines variables, so the sketch
+  and the wiring below have to share one translation unit.
+*/
+
+#include "../../low_power_sensor_inside/Sketch.cpp"
+
+#include <HostSim.h>
+
+// temperature offsets of the pond sensors against the climate model
+#define POND_OFFSET_0   -9.0
+#define POND_OFFSET_1   -7.0
+
+const char *hostSketchProfile()
+{
+	return HOST_PROFILE;
+}
+
+void hostSketchWire()
+{
+	// supply currents, see the data sheets of the modules
+	hostSimAttachLoad("led", LedPin, -1, 5.0);
+	hostSimAttachLoad("tx", EmitPowerPin, -1, 0.3);            // powered, no carrier
+	hostSimAttachLoad("tx-key", EmitPin, EmitPowerPin, 9.0);   // carrier on
+	hostSimAttachLoad("sensor", SensorPowerPin, -1, 1.0);
+	hostSimAttachRadio(EmitPin, EmitPowerPin);
+
+#if DHT22_use == 1
+	hostSimAttachDht22(SensorPin, SensorPowerPin);
+#endif
+
+#if DS18B20_use == 1
+	hostSimAttachDs18b20(SensorPin, SensorPowerPin, DEVICE_0, POND_OFFSET_0);
+	hostSimAttachDs18b20(SensorPin, SensorPowerPin, DEVICE_1, POND_OFFSET_1);
+#endif
+}
+
+double hostSketchInterval()
+{
+	return SleepTimer + tasks.jitterMs() / 1000.0;
+}
+
+int hostSketchSlots()
+{
+	return TX_SLOTS;
+}
+
+unsigned long hostSketchClockSeconds()
+{
+	return tasks.clockSeconds();
+}
+
+float hostSketchTruth(int value, uint64_t ns)
+{
+#if DHT22_use == 1
+	return value ? hostSimHumidity(ns) : hostSimTemperature(ns);
+#else
+	return hostSimTemperature(ns) + (value ? POND_OFFSET_1 : POND_OFFSET_0);
+#endif
+}
@@ -42,26 +42,72 @@ CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFT
 
 #include "LowPower.h"
 #include <RCSwitch.h>
+#include <FastGPIO.h>
+#include <BatteryMonitor.h>
+#include <WakeScheduler.h>
+#include <EELog.h>
+#include <Trace.h>
+#include <EventLog.h>
 #include <string.h>
 #include <avr/eeprom.h>
 //Beginning of Auto generated function prototypes by Atmel Studio
-void sleepSeconds(int seconds);
 void TempAndHum_DHT22();
 void prepare_onewire_data();
 void sendData(long dataTosend, long dataType);
-void trc(String msg);
 //End of Auto generated function prototypes by Atmel Studio
 void readEEData();
-long vccVoltage();
+void measureVoltage();
+void transmitValues();
+RCSwitch::Priority valuePriority(long dataTosend, long dataType);
+bool heartbeatDue();
+bool reportDue(RCSwitch::Priority priority);
+void transmitterOn();
+void transmitterOff();
+void traceDumpOnDemand();
+#if DS18B20_use == 1 && DS18B20_ADAPTIVE == 1
+uint8_t conversionResolution();
+#endif
+
+#define NO_READING (-32767 - 1) // no valid value, the NAN of the 0.1 units
 
-struct Data { // Sizeof should be 12 Bytes
-	uint16_t writecounter;		// used for counting eeprom writes, to limit the writing to the same cell (max 100k!)
-	float ee_temperature;		// used to store the temperature in eeprom
-	float ee_humidity;			// used to store the humidity in eeprom
+struct Data { // Sizeof should be 6 Bytes, one record of eeLog
+	int16_t ee_temperature;		// used to store the temperature in eeprom, 0.1 degree
+	int16_t ee_humidity;		// used to store the humidity in eeprom, 0.1 %
 	uint16_t tempdrop_counter;	// used to store the registered temperatures drops of more then 10 deg!
 };
 // create the RF Switch, needed for sending values
 RCSwitch mySwitch = RCSwitch();
+// battery voltage, measured on every VCC_EVERY_WAKES wake and for every heartbeat
+BatteryMonitor battery(VCC_EVERY_WAKES, VCC_SAMPLES);
+// the measure stage of a wake, sleeps while the sensor warms up
+WakeScheduler tasks;
+
+#if RF_FRAME_use == 1
+TelemetryFrame frame(NODE_ID); // collects the values of one wake, sent at the end of loop()
+RCSwitch::Priority framePriority = RCSwitch::PriorityLow; // highest priority of the collected values
+#else
+struct PendingCode {
+	long code;						// 24 bit RF code, value + topic offset or error code
+	RCSwitch::Priority priority;
+	int8_t value;					// index into lastSent, -1 for the voltage
+	long sent;						// for lastSent: the value or the error code
+};
+PendingCode pending[3]; // collects the codes of one wake: voltage and up to two values
+uint8_t pendingCount = 0;
+#endif
+
+bool txPowered = false; // transmitter powered in this wake, only for the burst of transmitValues()
+uint8_t silentWakes = 0; // wakes without a transmission, see HEARTBEAT_CYCLES
+long lastSent[2] = { atol(MIN_ERRORCODE), atol(MIN_ERRORCODE) }; // last value sent, [0] TEMP, [1] HUM or TEMP2
+#if RF_FRAME_use == 1
+long collected[2]; // the values in the frame, lastSent once it is sent
+uint8_t collectedMask = 0; // bit i: collected[i] is in the frame
+#endif
+
+// awake time accounting: millis() only counts while the CPU is not in power-down
+unsigned long wakeStart; // millis() at the start of loop()
+unsigned long awakeMs = 0; // awake time of the last wake
+uint8_t sensorRetries = 0; // failed sensor reads of the last wake, each one costs a power-down wait
 
 // SleepTimer: Time to deep sleep, adapted to error situation:
 // No error during measurement: Sleep for TimeToSleep
@@ -73,22 +119,27 @@ DHTNEW dht(SensorPin); // Setup a DHT sensor with data expected on pin SensorPin
 #endif
 
 #if DS18B20_use == 1
-OneWire oneWire(SensorPin); // Setup a oneWire instance to communicate with any OneWire devices (not just Maxim/Dallas temperature ICs)
+OneWireT<SensorPin> oneWire; // Setup a oneWire instance to communicate with any OneWire devices (not just Maxim/Dallas temperature ICs)
 DallasTemperature sensors(&oneWire); // Pass our oneWire reference to Dallas Temperature.
+#if DS18B20_ADAPTIVE == 1
+int16_t lastReading[2] = { NO_READING, NO_READING }; // DEVICE_0, DEVICE_1 of the last wake
+int16_t readingTrend[2] = { NO_READING, NO_READING }; // their change since the wake before
+#endif
 #endif
 
-// define humidity variable to hold the final value
-float humidity = NAN; // Set the default value to non valid values.
-float temperature = NAN; // Set the default value to non valid values.
+// define humidity variable to hold the final value, all values are in 0.1 units as they are sent (253 is 25.3)
+int16_t humidity = NO_READING; // Set the default value to non valid values.
+int16_t temperature = NO_READING; // Set the default value to non valid values.
 uint8_t temp_short_sleep = 0; // used to indicate that a difference of 10 degrees was measured and a short sleep is advised, once!
-bool fresh_eeprom = true; // indicates a fresh flashed chip with empty eeprom, address should start at 1 if true
-uint8_t ee_address = 1; // default start address, has to be adapted during runtime.
-Data ee_data;
-uint8_t ee_data_size;
-
-
-//Do we want to see trace for debugging purposes
-#define TRACE 0  // 0= trace off 1 = trace on
+Data ee_data; // read from the EEPROM once in setup(), kept in RAM through the sleeps
+EELog eeLog(0, EE_DATA_END, sizeof(Data), EE_LOG_REWRITES); // ee_data of the last writes, spread over the whole EEPROM
+Data ee_stored; // ee_data as it is in the EEPROM
+EELog eventSpill(EE_EVENT_LOG, EE_EVENT_END, sizeof(Event)); // the faults of eventLog, see EventLog.h
+uint8_t ee_skipped = 0; // writeEEData() calls since ee_data was written to the EEPROM, see EE_WRITE_DELTA
+
+#if TRACE
+TraceRing<TRACE_RECORDS> trace; // TRC() records of the last wakes, see ConfigData.h
+#endif
 
 
 void setAllPinInputLow()
@@ -98,43 +149,41 @@ void setAllPinInputLow()
 	// ALLOWS LOW POWER SLEEP 
 	// PIN STATES CHANGED LOCALLY AS REQUIRED 
 	// Important: MUST WRITE BACK TO INPUT LOW BEFORE SLEEP! 
-	for (byte i = 0; i <= A5; i++){
-		pinMode (i, INPUT);    // changed as per below
-		digitalWrite (i, LOW);  //     ditto
-	}
+	FastPins<0, A5>::mode(INPUT);
 }
 
 void ledOneBlink()
 {
 	// start led signal
-	pinMode(LedPin,OUTPUT);
-	digitalWrite(LedPin, HIGH);
+	FastPin<LedPin>::mode(OUTPUT);
+	FastPin<LedPin>::high();
 	delay(200);
-	digitalWrite(LedPin, LOW);
-	pinMode(LedPin,INPUT);
+	FastPin<LedPin>::low();
+	FastPin<LedPin>::mode(INPUT);
 }
 
-void pinPowerOn(const int PowerPin)
+template <uint8_t PowerPin>
+void pinPowerOn()
 {
-	pinMode(PowerPin,OUTPUT); // set the powerpin of the sensor to output
-	digitalWrite(PowerPin, HIGH); // give the powerpin 3.3 V
+	FastPin<PowerPin>::mode(OUTPUT); // set the powerpin of the sensor to output
+	FastPin<PowerPin>::high(); // give the powerpin 3.3 V
 }
 
-void pinPowerOff(const int PowerPin, const int SensorPin)
+template <uint8_t PowerPin, uint8_t SensorPin>
+void pinPowerOff()
 {
-	pinMode(PowerPin,INPUT);
-	digitalWrite(PowerPin, LOW);
-	pinMode(SensorPin,INPUT);      //disable the internal pull up resistor enable by dht.begin
-	digitalWrite(SensorPin, LOW);  // MR for getting rid of the last 13mA
+	FastPin<PowerPin>::mode(INPUT);
+	FastPin<SensorPin>::mode(INPUT);   //disable the internal pull up resistor enable by dht.begin
+	                                   // MR for getting rid of the last 13mA
 }
 
 void setup()
 {
 	setAllPinInputLow();
 
-	if (TRACE) {
-		Serial.begin(9600);
-	}
+	#if TRACE
+	Serial.begin(9600);
+	#endif
 	
 	#if DHT22_use == 1
 	// initialize the input for presence detection
@@ -153,176 +202,222 @@ void setup()
 	
 	SleepTimer = TimeToSleep; // Setup for long sleep, always hope the best!
 	// Launch traces for debugging purposes
-	trc("Start of the program");
+	TRC("Start of the program");
 	
-	// calculate sizeof one EEPROM Date Unit!
-	ee_data_size = sizeof (ee_data);
+	// repeats per priority, see ConfigData.h
+	mySwitch.setDeliveryTarget(RCSwitch::PriorityLow, RF_DELIVERY_LOW);
+	mySwitch.setDeliveryTarget(RCSwitch::PriorityNormal, RF_DELIVERY_NORMAL);
+	mySwitch.setDeliveryTarget(RCSwitch::PriorityHigh, RF_DELIVERY_HIGH);
+	mySwitch.setFrameLoss(RF_FRAME_LOSS);
+
+	// the wakes of nodes powered up together drift apart in random slots, see ConfigData.h
+	tasks.setJitter(TX_SLOTS, TX_SLOT_MS, NODE_ID);
+
+	// find the newest EEPROM record and load it, from now on the EEPROM is only written
+	eeLog.begin();
+	readEEData();
+
+	// the event log survives every reset but power-on, after the reset button it goes out over Serial
+	if (eventLog.begin(&eventSpill) & _BV(EXTRF)) {
+		Serial.begin(9600);
+		eventLog.dump(Serial);
+		Serial.flush();
+		#if !TRACE
+		Serial.end();
+		#endif
+	}
+	eventLog.spill(); // the reset
 
 }
 
 #if DHT22_use == 1
-void loop_dht22() // DHT22 only part of loop
+void loop_dht22() // DHT22 only part of loop, runs DHT22_WARMUP_MS after the sensor was powered in loop()
 {
-	pinPowerOn(SensorPowerPin);
-	delay(100); // added to give the DHT more time to startup, did not fix spontaneous temperature drops!
 	TempAndHum_DHT22();
-	pinPowerOff(SensorPowerPin, SensorPin);
+	pinPowerOff<SensorPowerPin, SensorPin>();
 }
 #endif
 
 #if DS18B20_use == 1
 
-float initDS18B20()
-{
-	sensors.begin(); //start up temp sensor
-	sensors.requestTemperatures(); // Get the temperature
-	return sensors.getTempCByIndex(0);
-}
-
-void loop_onewire()  // DS18B20 only part of loop
+void read_onewire()  // DS18B20 only part of loop, runs when the conversion started by loop_onewire() is done
 {
-	pinPowerOn(SensorPowerPin);
-	delay(750); // 750 ms needed for temperature calculations!
-
-	temperature = initDS18B20();	
-	
-	// Start up the library
-	sensors.begin();
-	// Grab a count of devices on the wire
-	numberOfDevices = sensors.getDeviceCount();
-	// set the resolution to TEMPERATURE_PRECISION bit (Each Dallas/Maxim device is capable of several different resolutions)
-	sensors.setResolution(TEMPERATURE_PRECISION);
+	if (sensors.isConversionComplete()) {
+		temperature = sensors.getTempDeci(DEVICE_0);
+		humidity = sensors.getTempDeci(DEVICE_1);
+	} else if (onewirePolls) { // the watchdog may have been faster than the sensor
+		onewirePolls--;
+		tasks.add(read_onewire, DS18B20_POLL_MS);
+		return;
+	} else { // the bus is held low, e.g. water in the probe: an error instead of polling on and on
+		temperature = DEVICE_DISCONNECTED_DECI;
+		humidity = DEVICE_DISCONNECTED_DECI;
+	}
 
-	sensors.requestTemperatures(); // Send the command to get temperatures
-	
-	temperature = sensors.getTempC(DEVICE_0);
-	humidity = sensors.getTempC(DEVICE_1);
+#if DS18B20_ADAPTIVE == 1
+	int16_t reading[2] = { temperature, humidity };
+	for (uint8_t i = 0; i < 2; i++) {
+		bool valid = reading[i] > DEVICE_DISCONNECTED_DECI && lastReading[i] > DEVICE_DISCONNECTED_DECI;
+		readingTrend[i] = valid ? reading[i] - lastReading[i] : NO_READING; // until two wakes were read
+		lastReading[i] = reading[i];
+	}
+#endif
 	
 #if 0
 	// only for testing: Delete later starting from here!
-	temperature = sensors.getTempC(DEVICE_2);
-	humidity = sensors.getTempC(DEVICE_2);
+	temperature = sensors.getTempDeci(DEVICE_2);
+	humidity = sensors.getTempDeci(DEVICE_2);
 	// end here
 #endif
 	
 	prepare_onewire_data(); // Use a simple function to copy the data
 	
-	pinPowerOff(SensorPowerPin, SensorPin);
+	pinPowerOff<SensorPowerPin, SensorPin>();
+}
+
+void loop_onewire()  // DS18B20 only part of loop, runs DS18B20_WARMUP_MS after the sensors were powered in loop()
+{
+	// Start up the library: the ROM codes come from the topology cache in the EEPROM, only a new
+	// or changed bus is searched and set to TEMPERATURE_PRECISION bit (written to the sensors' EEPROM)
+	bool cached = sensors.beginCached(EE_TOPOLOGY_CACHE, TEMPERATURE_PRECISION);
+	// Grab a count of devices on the wire
+	numberOfDevices = sensors.getDeviceCount();
+	if (!cached) {
+		TRC("OneWire bus searched");
+		EVENT(ONEWIRE_SEARCH, numberOfDevices);
+	}
+
+	// start the conversion, the scheduler sleeps in power-down until it is done
+#if DS18B20_ADAPTIVE == 1
+	uint16_t conversionMs = sensors.startConversion(conversionResolution());
+#else
+	uint16_t conversionMs = sensors.startConversion();
+#endif
+	onewirePolls = conversionMs / DS18B20_POLL_MS + 1;
+	tasks.add(read_onewire, conversionMs);
+}
+
+#if DS18B20_ADAPTIVE == 1
+uint8_t conversionResolution() // resolution of this wake's conversion, the coarser the shorter
+{
+	// the heartbeat sends the values anyway, with full precision
+	if (reportDue(RCSwitch::PriorityLow)) {
+		return TEMPERATURE_PRECISION;
+	}
+	// the step of the resolution must not be larger than the distance of the expected reading
+	// (last one plus its trend) to the deadband border around the last sent value
+	int16_t margin = DEADBAND_TEMP;
+	for (uint8_t i = 0; i < 2; i++) {
+		if ((lastSent[i] >= atol(MIN_ERRORCODE)) || (readingTrend[i] == NO_READING)) {
+			return TEMPERATURE_PRECISION; // nothing valid sent or read yet
+		}
+		int16_t m = DEADBAND_TEMP - abs(lastReading[i] + readingTrend[i] - (int16_t)lastSent[i]);
+		if (m < margin) {
+			margin = m;
+		}
+	}
+	return max(DS18B20_MIN_PRECISION, DallasTemperature::resolutionFor(margin));
 }
 #endif
+#endif
 
 void loop()
 {
-	// begin emitting
-	pinPowerOn(EmitPowerPin);
-	//pinMode(EmitPowerPin,OUTPUT);
-	//digitalWrite(EmitPowerPin, HIGH);
-	mySwitch.enableTransmit(EmitPin);  // Using Pin #6
-	mySwitch.setRepeatTransmit(15); //increase transmit repeat to avoid lost of rf sending
-
-	// send battery voltage
-	trc("Voltage: ");
-	trc(String(vccVoltage()));
-	sendData(vccVoltage(), atol(VOLT));
-
-	// read eeprom values
-	readEEData();
+	wakeStart = millis();
+	sensorRetries = 0;
+	eventLog.nextWake();
 
+	// The wake runs in three stages: measure, decide, transmit. sendData() only collects
+	// the values, transmitValues() decides what has to go out and powers the transmitter
+	// just for that burst, not through the sensor warm up and retries.
+
+	// measure: the sensor is powered first, the voltage is read while it warms up,
+	// the scheduler sleeps in power-down for the rest of the warm up time
+	tasks.start();
 	#if DHT22_use == 1
-		loop_dht22();
+		pinPowerOn<SensorPowerPin>();
+		tasks.add(loop_dht22, DHT22_WARMUP_MS);
 	#endif
-	
+	tasks.add(measureVoltage, 0);
 	#if DS18B20_use == 1
-		loop_onewire();
+		pinPowerOn<SensorPowerPin>();
+		tasks.add(loop_onewire, DS18B20_WARMUP_MS);
 	#endif
+	tasks.run();
+
+	transmitValues();
 	
-	//deactivate the transmitter
-	mySwitch.disableTransmit();
-	pinPowerOff(EmitPowerPin, EmitPin);
 //	pinMode(EmitPowerPin,INPUT);
 //	digitalWrite(EmitPowerPin,LOW); // mr
 //	pinMode(EmitPin,INPUT); //mr
 //	digitalWrite(EmitPin,LOW); // mr
 	
 
-	// sleep for x seconds
-	trc("Sleep");
-	sleepSeconds(SleepTimer);
-	//sleepSeconds(TimeToSleep);
+	awakeMs = millis() - wakeStart;
+	TRC2("Sleep after %d ms awake, %d sensor retries", awakeMs, sensorRetries);
+	traceDumpOnDemand();
+	if (sensorRetries) {
+		EVENT(SENSOR_RETRIES, sensorRetries);
+	}
+	eventLog.spill();
+
+	// sleep until SleepTimer seconds after the start of this wake, on the calibrated watchdog,
+	// plus the slot of the next wake
+	tasks.sleepUntil(SleepTimer * 1000UL);
 
 }
 
-void sleepSeconds(int seconds)
+void measureVoltage()
 {
-	for (int i = 0; i < (seconds/8); i++) { // changed SLEEP_1S to SLEEP_8S, so seconds have to be divided by 8 to match
-		LowPower.powerDown(SLEEP_8S, ADC_OFF, BOD_OFF);
-	}
+	// send battery voltage, a fresh one with the heartbeat, the cache counts from there
+	if (heartbeatDue()) battery.invalidate();
+	long vcc = battery.read();
+	tasks.addEntropy(vcc); // the last bits are ADC noise
+	TRC1("Voltage: %d mV", vcc);
+	sendData(vcc, atol(VOLT));
 }
 
 
-void checkForFreshEEprom(){ // reads the first Byte Address of the EEPROM and checks if the value is 255, the inital value, or 0
-	uint8_t ee_value;
-	ee_value = eeprom_read_byte((uint8_t*) 0);
-	if ((0 == ee_value) || (255 == ee_value)) { // zero or 255 detected, eeprom seems to be empty
-		ee_address = 1; // if eeprom is empty start after struct counter
-		fresh_eeprom = true;
-		eeprom_write_byte((uint8_t*) 0, 1);
-		} else { // value between 1 and 254 detected, not empty
-		ee_address = (ee_data_size * ee_value)-(ee_data_size-1); //
-		if ((ee_address + ee_data_size) > E2END){ // calculated address bigger then eeprom, should not happen, but in case start from adress 1
-			ee_address = 1;
-		}
-		fresh_eeprom = false;
+void readEEData(){
+	if (!eeLog.read(&ee_data)) { // empty eeprom
+		ee_data.tempdrop_counter=0;
+		ee_data.ee_temperature=NO_READING;
+		ee_data.ee_humidity=NO_READING;
 	}
+	ee_stored = ee_data;
 }
 
-void readEEData(){
-	Data localtmp;
-	checkForFreshEEprom(); // always test for empty eeprom and recalculate read and write address!
-	eeprom_read_block((void*)&localtmp, (const void*)ee_address, sizeof(localtmp));
-	if (fresh_eeprom) {
-		localtmp.writecounter=0;
-		localtmp.tempdrop_counter=0;
-		localtmp.ee_temperature=NAN;
-		localtmp.ee_humidity=NAN;
+bool eeDataChanged(){ // ee_data worth an eeprom write, see EE_WRITE_DELTA
+	if (ee_data.tempdrop_counter != ee_stored.tempdrop_counter) {
+		return true;
+	}
+	if ((ee_stored.ee_temperature == NO_READING) || (ee_stored.ee_humidity == NO_READING)) {
+		return true;
 	}
-	ee_data = localtmp;
+	return (abs(ee_data.ee_temperature - ee_stored.ee_temperature) >= EE_WRITE_DELTA) ||
+		(abs(ee_data.ee_humidity - ee_stored.ee_humidity) >= EE_WRITE_DELTA);
 }
 
 void writeEEData(boolean add_temp_drop){
-	unsigned int ee_value;
-	Data localtmp;
-	
 	if (add_temp_drop) { // temperature drop seen, so increase the value!
 		ee_data.tempdrop_counter++;
+		EVENT(TEMP_DROP, ee_data.tempdrop_counter);
 	}
-	ee_data.writecounter++;
-	
-	eeprom_update_block((const void*)&ee_data, (void*)ee_address, ee_data_size);
-	
-	if(ee_data.writecounter >= MAXEEPROMWRITE) { // the eeprom cell where the data is written to was written MAXEEPROMWRITE, use the next address block
-		ee_value = eeprom_read_byte((uint8_t*) 0);
-		ee_value++;
-		eeprom_update_byte((uint8_t*)0, ee_value);
-		ee_address = (ee_data_size * ee_value)-(ee_data_size-1); // calculate the new address
-		if ((ee_address + ee_data_size) > E2END){ // calculated address bigger then eeprom, should not happen, but in case start from EEPROM address 1
-			ee_address = 1;
-		} else { // now the new block has to be nulled, because probably only FFs are present
-			localtmp.writecounter=0;
-			localtmp.tempdrop_counter=0;
-			localtmp.ee_temperature=NAN;
-			localtmp.ee_humidity=NAN;
-			eeprom_write_block((const void*)&localtmp, (void*)ee_address, ee_data_size);			
-		}
+	if (!eeDataChanged() && ++ee_skipped < EE_WRITE_EVERY) { // ee_data stays in RAM only
+		return;
 	}
-	
+	eeLog.write(&ee_data);
+	EVENT(EE_WRITE, eeLog.head());
+	ee_stored = ee_data;
+	ee_skipped = 0;
 }
 
 #if DHT22_use == 1
 void measureTempAndHum_DHT22(){  // only for DHT22 usage!
 	// The original TempAndHum function was split two allow a better error handling
 	// This function now only measures and the handling of the values is done outside of this function.
-	delay(500);
+	// All waits are power-down sleeps ended by the watchdog, the sensor stays powered meanwhile.
+	// The warm up after power on is already over, see loop().
 	int loop = 0;
 	int chk;
 	while (loop < 5) {
@@ -343,7 +438,7 @@ void measureTempAndHum_DHT22(){  // only for DHT22 usage!
 			// Some unknown error, read again
 			break;
 		}
-		if (isnan(humidity) || isnan(temperature) || (chk != DHTLIB_OK)) { // not a number read, so do another turn!
+		if ((humidity == NO_READING) || (temperature == NO_READING) || (chk != DHTLIB_OK)) { // nothing read, so do another turn!
 			loop++;
 			} else {
 				if ((humidity > MAXHUMIDITY) || (temperature > MAXTEMPERATURE )) { // invalid value recieved, not catched by internal validation!
@@ -353,7 +448,10 @@ void measureTempAndHum_DHT22(){  // only for DHT22 usage!
 					break; // at least one correct value read, so exist while
 				}
 		}
-		delay(2100);
+		sensorRetries++;
+		if (loop < 5) { // the DHT22 needs 2 s between two reads, the calibrated watchdog gives 2.23 s at least
+			tasks.sleep(2250);
+		}
 	}
 }
 
@@ -362,9 +460,9 @@ void TempAndHum_DHT22(){ // only for DHT22
 	volatile int dropcheck_hum;
 	//retrieving value of temperature and humidity from DHT
 	measureTempAndHum_DHT22();
-	if (isnan(humidity) || isnan(temperature)) {
-		trc("Failed to read from DHT sensor!");
-		if (temp_short_sleep > 0) { // only send error message after two erroneous measurements aka NAN or TempDrop seen! 
+	if ((humidity == NO_READING) || (temperature == NO_READING)) {
+		TRC("Failed to read from DHT sensor!");
+		if (temp_short_sleep > 0) { // only send error message after two erroneous measurements aka NO_READING or TempDrop seen! 
 			sendData(atol(ERRORCODE), atol(HUM));//send error code, as the same error code is used for both, only send it once
 			temp_short_sleep = 0;
 		}
@@ -374,9 +472,9 @@ void TempAndHum_DHT22(){ // only for DHT22
 		//sendData(atol(ERRORCODE), atol(TEMP));//send error code
 		SleepTimer = TimeToSleepError; // Set sleep time for short sleep
 	} else {
-		if(isnan(ee_data.ee_humidity) || isnan(ee_data.ee_temperature)){
-			sendData(int(humidity*10), atol(HUM));
-			sendData(int(temperature*10), atol(TEMP));
+		if((ee_data.ee_humidity == NO_READING) || (ee_data.ee_temperature == NO_READING)){
+			sendData(humidity, atol(HUM));
+			sendData(temperature, atol(TEMP));
 			SleepTimer = TimeToSleep; // everything ok, so send to long sleep!
 			temp_short_sleep = 0;
 			// prepare data for writing
@@ -385,9 +483,9 @@ void TempAndHum_DHT22(){ // only for DHT22
 			// write to eeprom
 			writeEEData(false);
 		} else { // old values available from last measure check against huge difference in temp!
-			// Could also use fabsf(float1-float2) instead of abs (int(float1 - float2))
-			dropcheck_temp = ((int)ee_data.ee_temperature) - ((int)temperature);
-			dropcheck_hum = ((int)ee_data.ee_humidity) - ((int)humidity);
+			// whole degrees and %, truncated towards zero
+			dropcheck_temp = (ee_data.ee_temperature / 10) - (temperature / 10);
+			dropcheck_hum = (ee_data.ee_humidity / 10) - (humidity / 10);
 			if((dropcheck_temp > 10) and (dropcheck_hum > 10)) { // absolute difference between two measurement greater then 10 degrees? Better check again! 
 			//if((abs((int)(ee_data.ee_temperature-temperature)) > 10) and (abs((int)(ee_data.ee_humidity-humidity))> 10)) { 
 				if (temp_short_sleep < 1) { // not yet a short sleep timer set (two times we wait for correct values!)
@@ -402,8 +500,8 @@ void TempAndHum_DHT22(){ // only for DHT22
 					// write to eeprom
 					writeEEData(true);
 					//now send data
-					sendData(int(humidity*10), atol(HUM));
-					sendData(int(temperature*10), atol(TEMP));
+					sendData(humidity, atol(HUM));
+					sendData(temperature, atol(TEMP));
 					SleepTimer = TimeToSleep; // everything ok, so send to long sleep!
 				}
 
@@ -412,8 +510,8 @@ void TempAndHum_DHT22(){ // only for DHT22
 				ee_data.ee_humidity = humidity;
 				ee_data.ee_temperature = temperature;
 				writeEEData(false);
-				sendData(int(humidity*10), atol(HUM));
-				sendData(int(temperature*10), atol(TEMP));
+				sendData(humidity, atol(HUM));
+				sendData(temperature, atol(TEMP));
 				SleepTimer = TimeToSleep; // everything ok, so send to long sleep!
 			}
 		}
@@ -425,18 +523,19 @@ void TempAndHum_DHT22(){ // only for DHT22
 #if DS18B20_use == 1
 void prepare_onewire_data()
 {
-	if ((isnan(humidity) || isnan(temperature) || (humidity < -126.0) || (temperature < -126.0))) { // -127 is also a error value of the DS18B20!
-		trc("Failed to read from one of the onewire sensor!");
-		if (isnan(temperature) || (temperature < -126.0)) {
+	if ((humidity < -1260) || (temperature < -1260)) { // -127.0 is the error value of the DS18B20, NO_READING below it
+		TRC("Failed to read from one of the onewire sensor!");
+		EVENT(ONEWIRE_ERROR, temperature < -1260 ? 0 : 1);
+		if (temperature < -1260) {
 			sendData(atol(ERRORCODE), atol(TEMP));//send error code for Device_0
 		} else {
 			sendData(atol(ERRORCODE2), atol(TEMP2));//send error code for Device_1
 		}
 		SleepTimer = TimeToSleepError; // Set sleep time for short sleep
 	} else {
-	if(isnan(ee_data.ee_humidity) || isnan(ee_data.ee_temperature)){
-		sendData(int(humidity*10), atol(TEMP2));
-		sendData(int(temperature*10), atol(TEMP));
+	if((ee_data.ee_humidity == NO_READING) || (ee_data.ee_temperature == NO_READING)){
+		sendData(humidity, atol(TEMP2));
+		sendData(temperature, atol(TEMP));
 		SleepTimer = TimeToSleep; // everything ok, so send to long sleep!
 
 		// prepare data for writing
@@ -449,8 +548,8 @@ void prepare_onewire_data()
 			ee_data.ee_humidity = humidity; // temperature2
 			ee_data.ee_temperature = temperature;
 			writeEEData(false);
-			sendData(int(humidity*10), atol(TEMP2));
-			sendData(int(temperature*10), atol(TEMP));
+			sendData(humidity, atol(TEMP2));
+			sendData(temperature, atol(TEMP));
 			SleepTimer = TimeToSleep; // everything ok, so send to long sleep!
 		}
 	}
@@ -462,12 +561,34 @@ void sendData(long dataTosend, long dataType){
 	// long sum = atol(ERRORCODE); // original code
 	long sum = atol(MIN_ERRORCODE); // error code is at least this number big :-)
 	
-	trc("DataToSend");
-	trc(String(dataTosend));
-	trc("DataType");
-	trc(String(dataType));
-
-
+	TRC2("DataToSend %d DataType %d", dataTosend, dataType);
+
+
+	RCSwitch::Priority priority = valuePriority(dataTosend, dataType);
+	int8_t value = (dataType == atol(VOLT)) ? -1 : (dataType == atol(TEMP)) ? 0 : 1;
+
+#if RF_FRAME_use == 1
+	// only collect the value, transmitValues() sends them together
+	if (priority > framePriority) framePriority = priority;
+	if (value < 0) {
+		frame.setVoltage(dataTosend);
+	} else if (dataTosend >= sum) {
+		#if DHT22_use == 1
+		frame.setError(TELEMETRY_TEMPERATURE); // one error code for both values of the DHT22
+		frame.setError(TELEMETRY_VALUE2);
+		collected[0] = collected[1] = dataTosend;
+		collectedMask = 3;
+		#else
+		frame.setError(value ? TELEMETRY_VALUE2 : TELEMETRY_TEMPERATURE);
+		collected[value] = dataTosend;
+		collectedMask |= 1 << value;
+		#endif
+	} else {
+		frame.setValue(value ? TELEMETRY_VALUE2 : TELEMETRY_TEMPERATURE, dataTosend);
+		collected[value] = dataTosend;
+		collectedMask |= 1 << value;
+	}
+#else
 //	if (dataTosend == sum) { // original code
 	if (dataTosend >= sum) { 
 		// nothing to do sending error code
@@ -476,44 +597,128 @@ void sendData(long dataTosend, long dataType){
 		sum = dataTosend + dataType; // sending value added to topic offset
 	}
 	
-	trc("Sum");
-	trc(String(sum));
-	
-	//sending value by RF
-	mySwitch.send(sum,24);
+	TRC1("Sum %d", sum);
 	
+	// only collect the code, transmitValues() sends it
+	if (pendingCount < sizeof(pending) / sizeof(pending[0])) {
+		pending[pendingCount].code = sum;
+		pending[pendingCount].priority = priority;
+		pending[pendingCount].value = value;
+		pending[pendingCount].sent = dataTosend;
+		pendingCount++;
+	}
+#endif
 }
 
-// https://code.google.com/archive/p/tinkerit/wikis/SecretVoltmeter.wiki
-// https://provideyourown.com/2012/secret-arduino-voltmeter-measure-battery-voltage/
-long vccVoltage() {
-	long result = 0;
-	// Read 1.1V reference against AVcc
-	#if defined(__AVR_ATmega32U4__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
-	ADMUX = _BV(REFS0) | _BV(MUX4) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
-	#elif defined (__AVR_ATtiny24__) || defined(__AVR_ATtiny44__) || defined(__AVR_ATtiny84__)
-	ADMUX = _BV(MUX5) | _BV(MUX0);
-	#elif defined (__AVR_ATtiny25__) || defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__)
-	ADMUX = _BV(MUX3) | _BV(MUX2);
+// decide and transmit stage of loop(): sends what was collected by sendData()
+void transmitValues(){
+#if RF_FRAME_use == 1
+	uint8_t buf[TELEMETRY_FRAME_BYTES];
+	uint8_t bits;
+
+	if (frame.pending() && reportDue(framePriority)) { // otherwise all values within the deadband, no heartbeat yet
+		bits = frame.encode(buf);
+		TRC1("Frame %d bits", bits);
+		EVENT(SEND, framePriority);
+		transmitterOn();
+		mySwitch.setPriority(framePriority);
+		mySwitch.send(buf, bits);
+		// the deadband is around what the gateway got, the low priority values of the frame too
+		for (uint8_t i = 0; i < 2; i++) {
+			if (collectedMask & (1 << i)) lastSent[i] = collected[i];
+		}
+	}
+	frame.clear();
+	collectedMask = 0;
+	framePriority = RCSwitch::PriorityLow;
+#else
+	for (uint8_t i = 0; i < pendingCount; i++) {
+		if (!reportDue(pending[i].priority)) continue; // within the deadband, no heartbeat yet
+		//sending value by RF
+		EVENT(SEND, pending[i].priority);
+		transmitterOn();
+		mySwitch.setPriority(pending[i].priority);
+		mySwitch.send(pending[i].code,24);
+		if (pending[i].value >= 0) lastSent[pending[i].value] = pending[i].sent;
+	}
+	pendingCount = 0;
+#endif
+	transmitterOff();
+}
+
+// Error codes are repeated most, a value within the deadband around the value last sent least.
+// lastSent is only updated by transmitValues(), for what went on air.
+RCSwitch::Priority valuePriority(long dataTosend, long dataType){
+	uint8_t i = (dataType == atol(TEMP)) ? 0 : 1;
+	long deadband = 0;
+
+	#if REPORT_ON_CHANGE == 1
+	#if DHT22_use == 1
+	deadband = i ? DEADBAND_HUM : DEADBAND_TEMP;
+	#else
+	deadband = DEADBAND_TEMP;
+	#endif
+	#endif
+
+	if (dataTosend >= atol(MIN_ERRORCODE)) {
+		return RCSwitch::PriorityHigh;
+	}
+	if ((dataType == atol(VOLT)) || (labs(dataTosend - lastSent[i]) <= deadband)) {
+		return RCSwitch::PriorityLow;
+	}
+	return RCSwitch::PriorityNormal;
+}
+
+// The wake after HEARTBEAT_CYCLES - 1 silent ones transmits even within the deadband.
+bool heartbeatDue(){
+	#if REPORT_ON_CHANGE == 1
+	return silentWakes + 1 >= HEARTBEAT_CYCLES;
+	#else
+	return false; // every wake transmits
+	#endif
+}
+
+// Values of low priority only go out with the heartbeat when REPORT_ON_CHANGE is set.
+bool reportDue(RCSwitch::Priority priority){
+	#if REPORT_ON_CHANGE == 1
+	return (priority > RCSwitch::PriorityLow) || heartbeatDue();
 	#else
-	ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+	return true;
 	#endif
-	//ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
-	delay(10); // Wait for Vref to settle
-	ADCSRA |= _BV(ADSC); // Convert
-	while (bit_is_set(ADCSRA,ADSC));
-	result = ADCL;
-	result |= ADCH<<8;
-	result = 1126400L / result; // Back-calculate AVcc in mV
-	//result = 1125300L / result; // Back-calculate AVcc in mV // Calculate Vcc (in mV); 1125300 = 1.1*1023*1000
-	return result;
 }
 
+void transmitterOn(){
+	if (txPowered) return;
+	pinPowerOn<EmitPowerPin>();
+	#if defined(RCSWITCH_TX_PIN)
+	static_assert(EmitPin == RCSWITCH_TX_PIN, "RCSWITCH_TX_PIN is not the EmitPin");
+	#endif
+	mySwitch.enableTransmit(EmitPin);  // Using Pin #6, the repeats are set per value by setPriority()
+	txPowered = true;
+}
+
+void transmitterOff(){
+	if (txPowered) {
+		mySwitch.disableTransmit();
+		pinPowerOff<EmitPowerPin, EmitPin>();
+		txPowered = false;
+		silentWakes = 0;
+	} else if (silentWakes < 255) {
+		silentWakes++; // nothing left the deadband
+	}
+}
 
-//trace function
-void trc(String msg){
-	if (TRACE) {
-		Serial.println(msg);
+// sends the trace while TraceDumpPin is pulled to GND, the pull up is only on for the check
+void traceDumpOnDemand(){
+	#if TRACE
+	FastPin<TraceDumpPin>::mode(INPUT_PULLUP);
+	delayMicroseconds(10); // the pull up charges the pin
+	bool requested = FastPin<TraceDumpPin>::read() == LOW;
+	FastPin<TraceDumpPin>::mode(INPUT);
+	if (requested) {
+		trace.dump(Serial);
+		Serial.flush(); // all sent before the USART stops in power-down
 	}
+	#endif
 }
 
@@ -0,0 +1,41 @@
+/*
+  BatteryMonitor - supply voltage of the node, measured once per wake at most
+
+  AVcc is back-calculated from a conversion of the internal 1.1V bandgap
+  (https://code.google.com/archive/p/tinkerit/wikis/SecretVoltmeter.wiki).
+  The CPU sleeps in ADC noise reduction mode while the reference settles and
+  while every conversion runs, the ADC interrupt wakes it up again. Several
+  conversions can be averaged.
+
+  The battery voltage changes over weeks, so read() only measures on every
+  n-th call and returns the cached value otherwise.
+*/
+
+#ifndef BatteryMonitor_h
+#define BatteryMonitor_h
+
+#include <Arduino.h>
+
+class BatteryMonitor
+{
+public:
+	// measure on every 'everyWakes' call of read(), average 'samples' conversions
+	BatteryMonitor(uint8_t everyWakes, uint8_t samples);
+
+	// once per wake: the supply voltage in mV, measured or cached
+	long read();
+	// the last measured value without measuring, 0 before the first read()
+	long millivolt()			{ return _millivolt; };
+	// measure on the next read(), e.g. after a transmission error
+	void invalidate()			{ _wakes = 0; };
+
+private:
+	long measure();
+
+	uint8_t _everyWakes;
+	uint8_t _samples;
+	uint8_t _wakes;				// calls of read() until the next measurement
+	long _millivolt;
+};
+
+#endif
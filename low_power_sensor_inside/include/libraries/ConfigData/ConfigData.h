@@ -1,16 +1,24 @@
-#ifndef ConfigData_h
+﻿#ifndef ConfigData_h
 #define ConfigData_h
 
 // Here i comment out were the sensor will send its data from, this affects the sended RF values and in this version also the used sensors!
+// The location can also be given on the command line (-DSensor_Pond), the host simulator builds every location this way.
+#if !defined(Sensor_Bath) && !defined(Sensor_Balcony) && !defined(Sensor_MasterBed) && !defined(Sensor_Pond)
 //#define Sensor_Bath // Config Code for Sensor Bath?
 #define Sensor_Balcony // Config Code for Sensor Balcony?
 //#define Sensor_MasterBed // Config Code for Sensor MasterBedroom?
 //#define Sensor_Pond // Config Code for Sensor Pond?
+#endif
 
 // Which type of sensor do we want to use? This will be set now through the indirect through the location
 #define DS18B20_use     0 // 1 = used, 0 = unused; if sensor DS18B20 is used (only temperature values!!)
 #define DHT22_use       0 // 1 = used, 0 = unused; if sensor DHT22 is used (temperature and humidity)
 
+// How are the values sent? The gateway has to understand the chosen format!
+#ifndef RF_FRAME_use
+#define RF_FRAME_use    1 // 1 = all values of a wake in one 48 bit TelemetryFrame, 0 = one 24 bit code per value (VOLT/HUM/TEMP offsets below)
+#endif
+
 /*These values define the RF code value sent if the sensor values are
 equals to 0, for example, if the sensor value of temperature is 24°C, the
 program is going to send 33240, this resulting value can be interpreted
@@ -18,7 +26,9 @@ either at gateway level or better at domotic software level (example openhab)*/
 // MR: As the values can reach 4 numbers (100.0 for 100% humidity shift to 4 Numbers!
 #define MIN_ERRORCODE  "999900"
 #ifdef Sensor_Bath
+#undef DHT22_use
 #define DHT22_use       1
+#define NODE_ID         0 // TelemetryFrame node id, same as the board digit of the ERRORCODE
 // Bath Sensor Values
 #define HUM   "110000" // DHT 22 measures from 0.0 to 100.0
 #define TEMP  "130400" // the DHT 22 Sensor give temp from -40.0 to 80.0
@@ -29,7 +39,9 @@ either at gateway level or better at domotic software level (example openhab)*/
 #endif
 
 #ifdef Sensor_Balcony
+#undef DHT22_use
 #define DHT22_use       1
+#define NODE_ID         1 // TelemetryFrame node id, same as the board digit of the ERRORCODE
 // Balcony Sensor Values
 #define HUM   "210000" // DHT 22 measures from 0.0 to 100.0
 #define TEMP  "230400" // the DHT 22 Sensor give temp from -40.0 to 80.0
@@ -41,7 +53,9 @@ either at gateway level or better at domotic software level (example openhab)*/
 #endif
 
 #ifdef Sensor_MasterBed
+#undef DHT22_use
 #define DHT22_use       1
+#define NODE_ID         2 // TelemetryFrame node id, same as the board digit of the ERRORCODE
 // Master Bedroom Sensor Values
 #define HUM   "310000" // DHT 22 measures from 0.0 to 100.0
 #define TEMP  "330400" // the DHT 22 Sensor give temp from -40.0 to 80.0
@@ -52,7 +66,9 @@ either at gateway level or better at domotic software level (example openhab)*/
 #endif
 
 #ifdef Sensor_Pond
+#undef DS18B20_use
 #define DS18B20_use     1
+#define NODE_ID         3 // TelemetryFrame node id, same as the board digit of the ERRORCODE
 // Pond Sensor Values
 #define TEMP2 "410550" // the DS18B20 Sensor give temp from -55.0 to 125.0
 #define TEMP  "430550" // the DS18B20 Sensor give temp from -55.0 to 125.0
@@ -63,6 +79,31 @@ either at gateway level or better at domotic software level (example openhab)*/
 #define ERRORCODE2  "999932"  // Fourth Board (3Y) and Second Sensor (X2)
 #endif
 
+// How often is a value repeated? The repeats are derived from the probability that the gateway misses a single
+// frame and the wanted delivery probability of the value. Measure the loss at the gateway and set it per location
+// (#define RF_FRAME_LOSS in the location block above), nodes close to the gateway need far less airtime.
+#ifndef RF_FRAME_LOSS
+#define RF_FRAME_LOSS       500   // permille probability a single frame is lost, 500 gives 5/8/11 repeats for the targets below
+#endif
+#define RF_DELIVERY_LOW     900   // permille, battery voltage and unchanged values
+#define RF_DELIVERY_NORMAL  990   // changed values
+#define RF_DELIVERY_HIGH    999   // error codes
+
+// Report by exception: a wake only transmits if a value moved out of its deadband around the last sent value,
+// or an error is seen. Every HEARTBEAT_CYCLES wakes all values (and the voltage) are sent anyway.
+#ifndef REPORT_ON_CHANGE
+#define REPORT_ON_CHANGE    1   // 1 = suppress values within the deadband, 0 = send every wake
+#endif
+#define DEADBAND_TEMP       3   // 0.3 degree, in the 1/10 units sent
+#define DEADBAND_HUM        10  // 1.0 % humidity, in the 1/10 units sent
+#define HEARTBEAT_CYCLES    6   // send at least every 6th wake, roughly once an hour with TimeToSleep
+
+// Collision avoidance: nodes powered up together wake and send in lockstep, the calibrated watchdog keeps them
+// there. Every wake starts in a random one of TX_SLOTS slots after the end of TimeToSleep (slotted ALOHA), the
+// slots from NODE_ID and the noise of the node. Two nodes in lockstep meet in 1 of TX_SLOTS wakes.
+#define TX_SLOTS            32  // a wake up to 31 s late, the mean interval stays TimeToSleep; 1 = no jitter
+#define TX_SLOT_MS          1000 // longer than a burst of RF_DELIVERY_HIGH repeats, about 630 ms
+
 #if (DS18B20_use == 0) && (DHT22_use == 0)   // no DS18B20 and no DHT22
  #error At least one Sensor needs to be used! Check define of sensor location!
 #endif
@@ -76,12 +117,23 @@ either at gateway level or better at domotic software level (example openhab)*/
 #include <DallasTemperature.h>
 #endif
 
+// Battery voltage: the supply changes over weeks, so it is only measured on every VCC_EVERY_WAKES wake
+// and sent from the cache in between. A heartbeat always measures, see measureVoltage(), and restarts
+// the count. VCC_SAMPLES conversions are averaged.
+#define VCC_EVERY_WAKES     HEARTBEAT_CYCLES // in phase with the heartbeat while nothing else is sent
+#define VCC_SAMPLES         4
+
+#if RF_FRAME_use == 1   // binary frame instead of the 24 bit codes
+#include <TelemetryFrame.h>
+#endif
+
 #if DHT22_use == 1
 #define DHTTYPE DHT22 // which of the DHT sensors do we use= 11 or 22?
-#define MAXTEMPERATURE 80.0
-#define MINTEMPERATURE -40.0
-#define MINHUMIDITY 0.0
-#define MAXHUMIDITY 100.0
+#define MAXTEMPERATURE 800 // 80.0 degree, all values in the 0.1 units sent
+#define MINTEMPERATURE -400
+#define MINHUMIDITY 0
+#define MAXHUMIDITY 1000
+#define DHT22_WARMUP_MS 600 // sensor power on to the first read, the other work of the wake runs meanwhile
 #endif
 
 // Define the used pins for the sensors, these are Arduino pin numbers which are != ATMEGA328P pin numbers!
@@ -96,7 +148,17 @@ const int SensorPowerPin = 4;
 // define and declare different variables for the usage of the DS18B20
 #if DS18B20_use == 1
 #define TEMPERATURE_PRECISION 12
+// Adaptive resolution: while both values stay well inside their deadband the conversion runs
+// at a lower resolution (188 ms instead of 750 ms at 10 bit), see conversionResolution()
+#ifndef DS18B20_ADAPTIVE
+#define DS18B20_ADAPTIVE REPORT_ON_CHANGE
+#endif
+#define DS18B20_MIN_PRECISION 10 // 0.25 degree, the coarsest step below DEADBAND_TEMP
+#define DS18B20_WARMUP_MS 10 // sensor power on to the first bus reset
+#define DS18B20_POLL_MS 15 // conversion not done after the datasheet time, check again after this,
+                           // for another datasheet time at most: a bus held low is read as an error
 int numberOfDevices; // Number of temperature devices found (onewire aka ds18b20)
+uint8_t onewirePolls; // polls of read_onewire() left for this conversion
 DeviceAddress tempDeviceAddress; // We'll use this variable to store a found device address
 // declare the addresses of the expected sensors
 DeviceAddress DEVICE_0 = {0x28, 0x07, 0x1C, 0x43, 0x98, 0x0B, 0x00, 0x80};
@@ -104,10 +166,29 @@ DeviceAddress DEVICE_1 = {0x28, 0xFF, 0x04, 0x0A, 0xC1, 0x17, 0x01, 0x68};
 //DeviceAddress DEVICE_2 = {0x28, 0x07, 0x00, 0x07, 0x55, 0xBB, 0x01, 0x2C}; // this one is only for testing, not for productive!!!!
 #endif
 
-// I limit the writing to the cells to 30k writes, ATMEL says 100k is okay, but better be safe then sorry!
-// Lifetime for the EEPROM with a 30k write cycle would be roughly: 1023 bytes divided by 12 bytes per block = 85 blocks
-// 10 per hour x 24h x 356 days = ~86k writes a year, so roughly 3 (86k / 30k) blocks a year which gives us 28 years of lifetime (85 / 3).
-#define MAXEEPROMWRITE 30000
+// The data is written to the EEPROM as a log of ~110 records of 8 bytes (see EELog.h). A record is updated in
+// place EE_LOG_REWRITES times, then the log moves on to the next one, so each cell only sees every ~110th write.
+// ATMEL says 100k writes per cell are okay:
+// 10 per hour x 24h x 356 days = ~86k writes a year, ~0.8k per cell, which gives us ~120 years of lifetime.
+#define EE_LOG_REWRITES 100
+
+// The RAM keeps the data through the sleeps, the EEPROM copy is only needed after a reset. It is only written
+// when a value moved EE_WRITE_DELTA away from the stored one, the temperature drop counter changed, or
+// after EE_WRITE_EVERY writes were skipped (every ~6 hours at 10 writes per hour).
+#define EE_WRITE_DELTA 10 // 1.0 degree or %RH
+#define EE_WRITE_EVERY 60
+
+// The end of the EEPROM holds the OneWire topology cache and below it the faults of the EventLog, the data
+// log stays below EE_DATA_END.
+#if DS18B20_use == 1
+#define EE_TOPOLOGY_CACHE (E2END + 1 - sizeof(DallasTemperature::TopologyCache))
+#define EE_EVENT_END (EE_TOPOLOGY_CACHE - 1)
+#else
+#define EE_EVENT_END E2END
+#endif
+#define EE_EVENT_SLOTS 16 // faults kept in the EEPROM, 7 bytes each
+#define EE_EVENT_LOG (EE_EVENT_END + 1 - EE_EVENT_SLOTS * (sizeof(Event) + 2))
+#define EE_DATA_END (EE_EVENT_LOG - 1)
 
 //Pin on which the sensors are connected; Arduino Pin number, not ATMEGA328 Pin number!!
 const int LedPin = 9;
@@ -116,7 +197,15 @@ const int LedPin = 9;
 const int EmitPin = 6;
 const int EmitPowerPin = 7;
 
-const int TimeToSleep = 600; // set time to sleep (approx) in seconds, between 10 and 13 minutes, depending on temperature of the chip
-const int TimeToSleepError = 60; // short error time to sleep, around 1 minute
+// Trace for debugging: 1 = the TRC() records of the last wakes are kept in RAM and sent over Serial (9600 baud)
+// at the end of a wake while TraceDumpPin is pulled to GND (button or jumper), see Trace.h. 0 = no trace code at all.
+#ifndef TRACE
+#define TRACE 0
+#endif
+#define TRACE_RECORDS  16 // 10 bytes RAM each
+const int TraceDumpPin = 8;
+
+const int TimeToSleep = 600; // seconds from one wake to the next, the watchdog is calibrated against the system clock (WakeScheduler.h)
+const int TimeToSleepError = 60; // short error time to sleep, 1 minute
 
 #endif
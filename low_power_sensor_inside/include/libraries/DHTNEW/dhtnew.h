@@ -31,6 +31,15 @@
 // so by dividing F_CPU by 40000 we "fail" as fast as possible
 #define DHTLIB_TIMEOUT (F_CPU/40000)
 
+// Define DHTNEWEdgeCapture to read the sensor from the external interrupt of
+// the data pin instead of polling it with digitalRead(). The falling edges are
+// timestamped with Timer1 while the CPU sleeps in idle, the bits are decoded
+// afterwards. AVR only, the data pin must be an interrupt pin (INT0/INT1) and
+// Timer1 must not be used by anything else during read().
+#if defined( DHTNEWEdgeCapture ) && !defined( TCCR1B )
+#error "DHTNEWEdgeCapture needs Timer1"
+#endif
+
 class DHTNEW
 {
 public:
@@ -44,15 +53,17 @@ public:
     // lastRead is in MilliSeconds since start sketch
     uint32_t lastRead()               { return _lastRead; };
 
-    float humidity;
-    float temperature;
+    // in 0.1 units (%RH, degree C), the resolution of the sensor, so no
+    // float math is needed: 253 is 25.3
+    int16_t humidity;
+    int16_t temperature;
 
     // adding offsets works well in normal range 
-    // but can introduce under- or overflow
-    void  setHumOffset(float offset)  { _humOffset = offset; };
-    void  setTempOffset(float offset) { _tempOffset = offset; };
-    float getHumOffset()              { return _humOffset; };
-    float getTempOffset()             { return _tempOffset; };
+    // but can introduce under- or overflow, 0.1 units as well
+    void  setHumOffset(int16_t offset)  { _humOffset = offset; };
+    void  setTempOffset(int16_t offset) { _tempOffset = offset; };
+    int16_t getHumOffset()              { return _humOffset; };
+    int16_t getTempOffset()             { return _tempOffset; };
 
     bool getDisableIRQ()              { return _disableIRQ; };
     void setDisableIRQ(bool b )       { _disableIRQ = b; };
@@ -61,14 +72,17 @@ private:
     uint8_t  _pin = 0;
     uint8_t  _wakeupDelay = 0;
     uint8_t  _type = 0;
-    float    _humOffset = 0.0;
-    float    _tempOffset = 0.0;
+    int16_t  _humOffset = 0;
+    int16_t  _tempOffset = 0;
     uint32_t _lastRead = 0;
     bool     _disableIRQ = false;
 
     uint8_t  _bits[5];  // buffer to receive data
     int      _read();
     int      _readSensor();
+#if defined( DHTNEWEdgeCapture )
+    int      _readSensorEdges();
+#endif
 };
 #endif
 
@@ -21,6 +21,17 @@
 #include <inttypes.h>
 #include <OneWire.h>
 
+// ROM codes kept in RAM after begin() and in the topology cache, see beginCached()
+#ifndef DALLAS_CACHE_DEVICES
+#define DALLAS_CACHE_DEVICES 4
+#endif
+
+// failed reads of a cached device until beginCached() searches the bus again, a dead
+// device fails on every wake and must not cost a search (and EEPROM writes) every time
+#ifndef DALLAS_SEARCH_FAILURES
+#define DALLAS_SEARCH_FAILURES 8
+#endif
+
 // Model IDs
 #define DS18S20MODEL 0x10
 #define DS18B20MODEL 0x28
@@ -55,6 +66,7 @@
 
 // Error Codes
 #define DEVICE_DISCONNECTED -127
+#define DEVICE_DISCONNECTED_DECI (DEVICE_DISCONNECTED * 10)
 
 typedef uint8_t DeviceAddress[8];
 
@@ -67,6 +79,29 @@ class DallasTemperature
   // initalise bus
   void begin(void);
 
+  // Bus topology cache in the AVR EEPROM: the ROM codes, alarm settings, the parasite
+  // flag and the resolution of the last search, protected by a CRC over all of it.
+  struct TopologyCache
+  {
+    uint8_t devices;
+    uint8_t resolution;
+    uint8_t parasite;
+    uint8_t rom[DALLAS_CACHE_DEVICES][8];
+    uint8_t alarm[DALLAS_CACHE_DEVICES][2];
+    uint8_t crc;
+  };
+
+  // initalise bus from the cache at eeAddress: if the cache is valid, was written for
+  // this resolution and the bus answers the reset with a presence pulse, no search
+  // and no scratchpad write is done. Otherwise, and after DALLAS_SEARCH_FAILURES failed
+  // reads by getTempC() and getTempDeci(), the bus is searched and all devices are set to
+  // the resolution. The cache is only rewritten if the search found another topology.
+  // Returns true on a cache hit.
+  bool beginCached(uint16_t eeAddress, uint8_t resolution);
+
+  // forces a search on the next beginCached(), the cache in the EEPROM stays as it is
+  void invalidateCache(void);
+
   // returns the number of devices found on the bus
   uint8_t getDeviceCount(void);
   
@@ -89,8 +124,8 @@ class DallasTemperature
   // read device's scratchpad
   void readScratchPad(uint8_t*, uint8_t*);
 
-  // write device's scratchpad
-  void writeScratchPad(uint8_t*, const uint8_t*);
+  // write device's scratchpad, copy = false leaves the device's EEPROM as it is
+  void writeScratchPad(uint8_t*, const uint8_t*, bool copy = true);
 
   // read device's power requirements
   bool readPowerSupply(uint8_t*);
@@ -104,7 +139,7 @@ class DallasTemperature
   // returns the device resolution, 9-12
   uint8_t getResolution(uint8_t*);
 
-  // set resolution of a device to 9, 10, 11, or 12 bits
+  // set resolution of a device to 9, 10, 11, or 12 bits, copied to its EEPROM if it changed
   bool setResolution(uint8_t*, uint8_t);
   
   // sets/gets the waitForConversion flag
@@ -124,9 +159,30 @@ class DallasTemperature
   // sends command for one device to perform a temperature conversion by index
   bool requestTemperaturesByIndex(uint8_t);
 
+  // non-blocking: sends command for all devices on the bus to perform a temperature
+  // conversion and returns the ms it takes at the global resolution, the caller
+  // may sleep meanwhile and read the temperatures afterwards
+  uint16_t startConversion(void);
+
+  // non-blocking at the given resolution: if it differs from the one the devices use,
+  // only their scratchpads are written, the EEPROM keeps the global resolution and
+  // the devices return to it at the next power up. Returns the ms the conversion takes.
+  uint16_t startConversion(uint8_t);
+
+  // ms a conversion takes at a resolution of 9, 10, 11 or 12 bits
+  static uint16_t millisToWaitForConversion(uint8_t);
+
+  // lowest resolution whose step is not larger than margin (0.1 degree C), 9-12: a value
+  // that far from a threshold can not cross it by quantisation alone
+  static uint8_t resolutionFor(int16_t margin);
+
   // returns temperature in degrees C
   float getTempC(uint8_t*);
 
+  // returns temperature in 0.1 degrees C truncated towards zero, the same as
+  // int(getTempC() * 10) without float math, or DEVICE_DISCONNECTED_DECI
+  int16_t getTempDeci(uint8_t*);
+
   // returns temperature in degrees F
   float getTempF(uint8_t*);
 
@@ -218,12 +274,26 @@ class DallasTemperature
   
   // count of devices on the bus
   uint8_t devices;
+
+  // ROM codes and TH, TL of the first DALLAS_CACHE_DEVICES devices found by begin()
+  DeviceAddress rom[DALLAS_CACHE_DEVICES];
+  uint8_t alarm[DALLAS_CACHE_DEVICES][2];
+
+  // resolution currently in the devices' scratchpads, see startConversion(uint8_t)
+  uint8_t convResolution;
+
+  // failed reads since the last search, see DALLAS_SEARCH_FAILURES
+  uint8_t readFailures;
+
+  void fillCache(TopologyCache*);
   
   // Take a pointer to one wire instance
   OneWire* _wire;
 
   // reads scratchpad and returns the temperature in degrees C
   float calculateTemperature(uint8_t*, uint8_t*);
+  // the same in 0.1 degrees C
+  int16_t calculateTemperatureDeci(uint8_t*, uint8_t*);
   
   void	blockTillConversionComplete(uint8_t*,uint8_t*);
   
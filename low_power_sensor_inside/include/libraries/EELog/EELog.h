@@ -0,0 +1,91 @@
+/*
+  EELog - wear levelled record log in the EEPROM
+
+  The EEPROM area from 'start' to 'end' is split into slots of one record
+  each. append() goes to the slot after the newest one, so all slots wear
+  out at the same rate instead of one block taking every write:
+
+  byte 0..size-1   the record
+  byte size        CRC-8 (Dallas/Maxim) of the record and the sequence number
+  byte size+1      sequence number, one more than the slot before, modulo 255
+
+  0xFF is never used as sequence number, it marks an erased slot. A slot is
+  erased before its record is programmed and gets its sequence number last:
+  a write cut short by a reset or brown-out leaves an erased slot behind, and
+  the slot before stays the newest record. The CRC alone would take a mix of
+  old and new bytes for a record once in 256 cuts.
+
+  Slot 0 always holds the oldest record of the current round, the slots up to
+  the newest one follow without a gap in the sequence numbers. begin() finds
+  the newest record with a binary search on that, in a few EEPROM reads. Only
+  if slot 0 is not valid (erased chip, or its write was cut short) all slots
+  are read.
+
+  Writes use eeprom_update_*, bytes that are already right are not
+  programmed again. A new slot holds a record of a whole round ago, nearly
+  all of its bytes change. write() therefore updates the newest record in
+  place and only moves on to the next slot every 'rewrites' writes: every
+  cell is still programmed once per 'rewrites' x slots writes, but most writes
+  only cost the changed bytes, the CRC and the sequence number twice. A
+  write cut short in place leaves the slot erased, the record before it
+  becomes the newest one again. The only record of the log is never written
+  in place.
+*/
+
+#ifndef EELog_h
+#define EELog_h
+
+#include <Arduino.h>
+
+// erased, and the modulus of the sequence numbers
+#define EELOG_ERASED    0xFF
+// slots are limited to half the modulus: scan() orders two sequence numbers
+// by the shorter way round, which only holds for less than half of it
+#define EELOG_MAX_SLOTS (EELOG_ERASED / 2)
+
+class EELog
+{
+public:
+	// records of 'size' bytes in the EEPROM from 'start' up to and including 'end',
+	// each one written 'rewrites' times by write()
+	EELog(uint16_t start, uint16_t end, uint8_t size, uint8_t rewrites = 1);
+
+	// finds the newest record, once after reset; false if there is none
+	bool begin();
+	// copies the newest record to 'record', false if there is none
+	bool read(void *record);
+	// the record appended 'back' slots before the newest one, false if its
+	// slot was never written or holds something else by now
+	bool readBack(uint8_t back, void *record);
+	// stores 'record' as the newest one, in the next slot
+	void append(const void *record);
+	// the same, in place of the newest one if it was not written 'rewrites'
+	// times yet; the first write after begin() always goes to the next slot
+	void write(const void *record);
+
+	uint8_t slots()				{ return _slots; };
+	// slot of the newest record, 0 again after a round through the area
+	uint8_t head()				{ return _head; };
+
+private:
+	uint8_t *address(uint8_t slot)	{ return (uint8_t*)(uintptr_t)(_start + (uint16_t)slot * (_size + 2)); };
+	uint8_t sequence(uint8_t slot);
+	static uint8_t crc8(uint8_t crc, uint8_t in);
+	bool valid(uint8_t slot);
+	bool inRound(uint8_t slot, uint8_t first);
+	bool search();
+	bool scan();
+	void program(uint8_t slot, uint8_t seq, const void *record);
+
+	uint16_t _start;
+	uint8_t _size;
+	uint8_t _slots;
+	uint8_t _rewrites;
+	uint8_t _writes;			// writes of the newest slot since append()
+	uint8_t _head;				// slot of the newest record
+	uint8_t _seq;				// its sequence number
+	bool _empty;
+	bool _single;				// no valid record in the slot before the newest one
+};
+
+#endif
@@ -0,0 +1,111 @@
+/*
+  EventLog - binary event log for post-mortem analysis, on in production
+
+  EVENT(DHT_TIMEOUT, edges) stores one event: its id, the wake counter and
+  a 16 bit argument, 5 bytes in a RAM ring of EVENTLOG_EVENTS events. That
+  is a handful of stores, the log can stay on in every build.
+
+  The ring is in the .noinit section: the C startup code does not clear it,
+  so it survives a watchdog, brown-out or external reset. begin() keeps it
+  if its header is intact and starts a new one otherwise (power-on), and
+  logs the reset with the flags of MCUSR.
+
+  Faults, the ids from EVENT_FAULT up, are also spilled to a small EELog in
+  the EEPROM by spill() at the end of a wake, each id once per reset and at
+  most EVENTLOG_SPILL_MAX per wake: a sensor that stays broken would wear out
+  the EEPROM within months, its repeats are only in the ring. The spilled
+  faults survive a flat battery. After a power-on the wake counter goes on
+  from the newest spilled event.
+
+  dump() sends the EEPROM events and then the ring over Serial, one
+  "ev <wake> <id> <arg>" line each. HostSim/build/evdecode turns such a dump
+  into a timeline with the names and meanings of EVENTLOG_LIST below.
+*/
+
+#ifndef EventLog_h
+#define EventLog_h
+
+#include <Arduino.h>
+#include <EELog.h>
+
+// events in the RAM ring, a power of two
+#ifndef EVENTLOG_EVENTS
+#define EVENTLOG_EVENTS     32
+#endif
+// faults spilled to the EEPROM per wake at most, each costs 7 EEPROM bytes
+#define EVENTLOG_SPILL_MAX  4
+
+// id, name, meaning of the argument; the ids are in the dumps, never reuse one
+#define EVENTLOG_LIST(E) \
+	E(0x01, VCC,            "supply voltage measured, mV") \
+	E(0x02, EE_WRITE,       "EEPROM data written, slot (0 again: round through the EEPROM)") \
+	E(0x03, ONEWIRE_SEARCH, "OneWire bus searched, devices found") \
+	E(0x04, SENSOR_RETRIES, "sensor read again, retries of the wake") \
+	E(0x05, SEND,           "values sent, priority 0 low .. 2 high") \
+	E(0x06, WDT_CALIBRATED, "watchdog calibrated, us of the nominal 16 ms period") \
+	E(0x80, RESET,          "reset, MCUSR: 1 power-on, 2 external, 4 brown-out, 8 watchdog") \
+	E(0x81, DHT_TIMEOUT,    "DHT timeout, edges captured of 42 (0 without DHTNEWEdgeCapture)") \
+	E(0x82, DHT_CHECKSUM,   "DHT checksum wrong, received << 8 | calculated") \
+	E(0x83, ONEWIRE_ERROR,  "DS18B20 not read, device 0 or 1") \
+	E(0x84, TEMP_DROP,      "drop of more than 10 degrees, drops counted")
+
+#define EVENTLOG_ENUM(id, name, text) EVENT_##name = id,
+enum EventId
+{
+	EVENTLOG_LIST(EVENTLOG_ENUM)
+	EVENT_FAULT = 0x80
+};
+// fault ids EVENT_FAULT .. EVENT_FAULT + 15, see EventLog::spill()
+#undef EVENTLOG_ENUM
+
+#define EVENT(name, arg)    eventLog.put(EVENT_##name, (arg))
+
+struct Event
+{
+	uint8_t id;
+	uint16_t wake;
+	int16_t arg;
+} __attribute__((packed));
+
+class EventLog
+{
+public:
+	// once in setup(): keeps or starts the ring, faults go to 'spill';
+	// returns the reset flags of MCUSR
+	uint8_t begin(EELog *spill);
+	// start of a wake
+	void nextWake()				{ _wake++; };
+
+	void put(uint8_t id, int16_t arg)
+	{
+		Event *e = &_event[_head];
+		e->id = id;
+		e->wake = _wake;
+		e->arg = arg;
+		_head = (_head + 1) & (EVENTLOG_EVENTS - 1);
+	}
+
+	// end of a wake: faults since the last call to the EEPROM
+	void spill();
+	// all events, oldest first
+	void dump(HardwareSerial &out);
+
+	uint16_t wake()				{ return _wake; };
+
+private:
+	static void print(HardwareSerial &out, const Event *e);
+
+	// no constructor: it would clear the ring after every reset
+	uint16_t _magic;			// EVENTLOG_MAGIC: the ring survived a reset
+	uint16_t _wake;
+	uint8_t _head;				// slot of the next event
+	uint8_t _spilled;			// events before this one were seen by spill()
+	uint16_t _spilledIds;		// bit id - EVENT_FAULT: spilled since begin()
+	Event _event[EVENTLOG_EVENTS];
+	EELog *_spill;
+};
+
+// the log of the node, in .noinit
+extern EventLog eventLog;
+
+#endif
@@ -0,0 +1,67 @@
+/*
+  FastGPIO - digital pins with the port and bit resolved at compile time
+
+  FastPin<Pin> does what pinMode(), digitalWrite() and digitalRead() do, for a
+  pin number known at compile time. The three table lookups, the PWM check and
+  the SREG save of wiring_digital.c go away: every call is a single sbi, cbi or
+  sbic (two for mode(INPUT) and mode(INPUT_PULLUP)), and a single instruction
+  is atomic, also against interrupts.
+
+  Pin numbers are the ones of the standard variant (ATmega328P, LilyPad):
+  0-7 PORTD, 8-13 PORTB, 14-19 (A0-A5) PORTC.
+
+  Unlike digitalWrite(), write() does not switch off the PWM of the pin, do not
+  use FastPin on pins driven by analogWrite().
+*/
+
+#ifndef FastGPIO_h
+#define FastGPIO_h
+
+#include <Arduino.h>
+
+// register of the port of Pin, e.g. FASTGPIO_REG(PORT) is PORTD, PORTB or PORTC
+#define FASTGPIO_REG(reg) (Pin < 8 ? reg##D : (Pin < 14 ? reg##B : reg##C))
+
+template <uint8_t Pin>
+struct FastPin
+{
+	static_assert(Pin < 20, "FastPin: no such pin");
+	static const uint8_t mask = 1 << (Pin < 8 ? Pin : (Pin < 14 ? Pin - 8 : Pin - 14));
+
+	static void high()              { FASTGPIO_REG(PORT) |= mask; }
+	static void low()               { FASTGPIO_REG(PORT) &= ~mask; }
+	static void write(uint8_t v)    { if (v) high(); else low(); }
+	static uint8_t read()           { return (FASTGPIO_REG(PIN) & mask) ? HIGH : LOW; }
+
+	// the direction only, the PORT bit (output level or pull up) is kept
+	static void output()            { FASTGPIO_REG(DDR) |= mask; }
+	static void input()             { FASTGPIO_REG(DDR) &= ~mask; }
+
+	// like pinMode(): INPUT also switches off the pull up
+	static void mode(uint8_t mode)
+	{
+		if (mode == OUTPUT) {
+			output();
+		} else {
+			input();
+			write(mode == INPUT_PULLUP);
+		}
+	}
+};
+
+// FastPins<First, Last>: the same for all pins from First to Last
+template <uint8_t First, uint8_t Last>
+struct FastPins
+{
+	static void mode(uint8_t mode)  { FastPin<First>::mode(mode); FastPins<First + 1, Last>::mode(mode); }
+	static void write(uint8_t v)    { FastPin<First>::write(v); FastPins<First + 1, Last>::write(v); }
+};
+
+template <uint8_t Last>
+struct FastPins<Last, Last>
+{
+	static void mode(uint8_t mode)  { FastPin<Last>::mode(mode); }
+	static void write(uint8_t v)    { FastPin<Last>::write(v); }
+};
+
+#endif
@@ -148,7 +148,19 @@ class LowPowerClass
 			void	powerSave(period_t period, adc_t adc, bod_t bod, timer2_t timer2) __attribute__((optimize("-O1")));
 			void	powerStandby(period_t period, adc_t adc, bod_t bod) __attribute__((optimize("-O1")));
 			void	powerExtStandby(period_t period, adc_t adc, bod_t bod, timer2_t timer2) __attribute__((optimize("-O1")));
-		
+
+		#elif defined (HOST_SIM)
+
+			// ATmega328P interface, implemented by the host simulator (HostSim)
+			void	idle(period_t period, adc_t adc, timer2_t timer2,
+					     timer1_t timer1, timer0_t timer0, spi_t spi,
+				         usart0_t usart0, twi_t twi);
+			void	adcNoiseReduction(period_t period, adc_t adc, timer2_t timer2);
+			void	powerDown(period_t period, adc_t adc, bod_t bod);
+			void	powerSave(period_t period, adc_t adc, bod_t bod, timer2_t timer2);
+			void	powerStandby(period_t period, adc_t adc, bod_t bod);
+			void	powerExtStandby(period_t period, adc_t adc, bod_t bod, timer2_t timer2);
+
 		#elif defined (__arm__)
 			
 			#if defined (__SAMD21G18A__)
@@ -0,0 +1,69 @@
+/*
+  TelemetryFrame - all readings of one wake cycle in one RF frame
+
+  Instead of one 24 bit RCSwitch code per value (VOLT, HUM, TEMP), the node
+  sends one 48 bit frame, MSB first:
+
+  byte 0      node id (high nibble), sequence number (low nibble)
+  byte 1      supply voltage, 20mV steps above 1500mV, 0 = no value
+  byte 2..4   value 0 and value 1, 12 bit two's complement each, 0.1 units
+  byte 5      CRC-8 (Dallas/Maxim) of byte 0..4
+
+  Value 0 is the temperature, value 1 the humidity (DHT22) or the second
+  temperature (DS18B20). A gap in the sequence numbers shows lost frames.
+*/
+
+#ifndef TelemetryFrame_h
+#define TelemetryFrame_h
+
+#include <Arduino.h>
+
+#define TELEMETRY_FRAME_BYTES   6
+#define TELEMETRY_FRAME_BITS    (TELEMETRY_FRAME_BYTES * 8)
+#define TELEMETRY_VALUES        2
+
+#define TELEMETRY_TEMPERATURE   0
+#define TELEMETRY_VALUE2        1   // humidity or second temperature
+
+// reserved values of a 12 bit value field
+#define TELEMETRY_NO_VALUE      -2048   // not measured in this cycle
+#define TELEMETRY_ERROR         -2047   // sensor failed
+
+#define TELEMETRY_MV_BASE       1500
+#define TELEMETRY_MV_STEP       20
+
+struct TelemetryData
+{
+	uint8_t  node;
+	uint8_t  seq;
+	uint16_t millivolt;                 // 0 = no value
+	int16_t  value[TELEMETRY_VALUES];   // 0.1 units, TELEMETRY_NO_VALUE or TELEMETRY_ERROR
+};
+
+class TelemetryFrame
+{
+public:
+	TelemetryFrame(uint8_t node);
+
+	// start a new frame, all fields without value
+	void clear();
+	void setVoltage(long millivolt);
+	void setValue(uint8_t index, int deci);
+	void setError(uint8_t index);
+	// true if anything was set since clear()
+	bool pending()                  { return _pending; };
+
+	// writes TELEMETRY_FRAME_BYTES to buf, returns the number of bits
+	// and advances the sequence number
+	uint8_t encode(uint8_t *buf);
+
+	// gateway side: false if the CRC does not match
+	static bool decode(const uint8_t *buf, TelemetryData *data);
+	static uint8_t crc8(const uint8_t *p, uint8_t len);
+
+private:
+	TelemetryData _data;
+	bool _pending;
+};
+
+#endif
@@ -0,0 +1,105 @@
+/*
+  Trace - binary trace records in a RAM ring, no String, no heap
+
+  TRC(format), TRC1(format, a) and TRC2(format, a, b) store one record: the
+  flash address of the format text and up to two long arguments. Nothing is
+  formatted or sent while the node runs, a record costs a few stores. The
+  ring keeps the newest 'Records' records, older ones are overwritten.
+
+  dump() sends the records, oldest first, as text over a HardwareSerial and
+  empties the ring. Every %d of the format is replaced by the next argument
+  as a signed decimal, %% is a '%'. There is no printf() behind it.
+
+  With TRACE 0 (ConfigData.h) the macros expand to nothing, their arguments
+  are not evaluated and the format texts do not reach the flash. The sketch
+  only defines the ring itself with TRACE 1:
+
+    #if TRACE
+    TraceRing<TRACE_RECORDS> trace;
+    #endif
+*/
+
+#ifndef Trace_h
+#define Trace_h
+
+#include <Arduino.h>
+
+#if TRACE
+#define TRC(format)             trace.put(PSTR(format), 0, 0)
+#define TRC1(format, a)         trace.put(PSTR(format), (a), 0)
+#define TRC2(format, a, b)      trace.put(PSTR(format), (a), (b))
+#else
+#define TRC(format)             ((void)0)
+#define TRC1(format, a)         ((void)0)
+#define TRC2(format, a, b)      ((void)0)
+#endif
+
+template <uint8_t Records>
+class TraceRing
+{
+public:
+	TraceRing() : _next(0), _count(0), _lost(0) {}
+
+	// stores one record, 'format' is in flash (PSTR)
+	void put(const char *format, long a, long b)
+	{
+		Record *r = &_ring[_next];
+		r->format = format;
+		r->arg[0] = a;
+		r->arg[1] = b;
+		_next = _next + 1 == Records ? 0 : _next + 1;
+		if (_count < Records) _count++;
+		else if (_lost < 0xFFFF) _lost++;
+	}
+
+	// sends all records to 'out' and empties the ring
+	void dump(HardwareSerial &out)
+	{
+		if (_lost) {
+			out.print("trace: ");
+			out.print((long)_lost);
+			out.println(" records lost");
+		}
+		uint8_t i = _next >= _count ? _next - _count : _next + Records - _count;
+		for (; _count; _count--) {
+			print(out, &_ring[i]);
+			i = i + 1 == Records ? 0 : i + 1;
+		}
+		_lost = 0;
+	}
+
+	uint8_t count()				{ return _count; };
+
+private:
+	struct Record {
+		const char *format;		// in flash
+		long arg[2];
+	};
+
+	static void print(HardwareSerial &out, const Record *r)
+	{
+		uint8_t n = 0;
+		for (const char *p = r->format; ; p++) {
+			char c = pgm_read_byte(p);
+			if (!c) break;
+			if (c == '%') {
+				char f = pgm_read_byte(p + 1);
+				if (f == 'd' && n < 2) {
+					out.print(r->arg[n++]);
+					p++;
+					continue;
+				}
+				if (f == '%') p++;
+			}
+			out.write((uint8_t)c);
+		}
+		out.println();
+	}
+
+	Record _ring[Records];
+	uint8_t _next;				// slot of the next record
+	uint8_t _count;				// records in the ring
+	uint16_t _lost;				// records overwritten since the last dump()
+};
+
+#endif
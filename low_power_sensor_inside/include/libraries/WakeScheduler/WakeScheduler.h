@@ -0,0 +1,128 @@
+/*
+  WakeScheduler - cooperative tasks of one wake cycle
+
+  Tasks are plain functions that run once, at a given time after start().
+  run() calls every task when its time has come, in the order they were
+  added, and sleeps in power-down until the next one is due. A task may add
+  further tasks, e.g. a retry.
+
+  The time counts awake time (millis()) plus the watchdog periods slept by
+  the scheduler. millis() stops in every sleep mode but idle, so sleeps of
+  other code are not counted and a task may run late, never early.
+
+  The watchdog periods are 2K << n cycles of the 128kHz oscillator, which
+  runs 10-20% off and drifts with the chip temperature. Power-down stops the
+  clock source, every wake up waits for its start-up time on top of the
+  period: the CKSEL and SUT bits of WAKE_SCHEDULER_LOW_FUSE give it. Every
+  WAKE_SCHEDULER_CALIBRATE wakes the first sleep of at least one period
+  spends that period in idle instead, timed with Timer1 against the system
+  clock. All sleeps are then composed of the calibrated 8s..16ms periods,
+  sleepUntil() ends the wake cycle at a fixed interval, and clockSeconds()
+  counts the time since power on from the calibrated periods.
+
+  Nodes powered up together would wake, and send, in lockstep for good: the
+  calibration takes away the drift that would part them. setJitter() moves
+  every wake of sleepUntil() into one of a few slots after the interval,
+  a random slot per wake (slotted ALOHA). Two nodes in lockstep then meet in
+  one of 'slots' wakes, the mean interval does not change. The random
+  numbers start from a seed, e.g. the node id, and every calibration and
+  addEntropy() stir in noise.
+*/
+
+#ifndef WakeScheduler_h
+#define WakeScheduler_h
+
+#include <Arduino.h>
+
+#ifndef WAKE_SCHEDULER_TASKS
+#define WAKE_SCHEDULER_TASKS 6
+#endif
+// start() calls from one calibration to the next, a calibration costs 16ms in idle
+#ifndef WAKE_SCHEDULER_CALIBRATE
+#define WAKE_SCHEDULER_CALIBRATE 6
+#endif
+// low fuse the node is programmed with, for the start-up time after power-down
+// (ATmega328P datasheet, "System Clock and Clock Options"):
+//   0xFF  LilyPad, low power crystal oscillator, slowly rising power: 16K CK
+//   0xF7  full swing crystal oscillator, the same SUT: 16K CK
+//   0xE2  internal 8MHz RC oscillator: 6 CK
+#ifndef WAKE_SCHEDULER_LOW_FUSE
+#define WAKE_SCHEDULER_LOW_FUSE 0xFF
+#endif
+
+// the slot of every wake, the random numbers of one node
+class WakeJitter
+{
+public:
+	WakeJitter();
+
+	// 'slots' slots of 'slotMs', 1 slot = no jitter
+	void begin(uint8_t slots, uint16_t slotMs, uint16_t seed);
+	// stirs 'noise' into the random numbers
+	void mix(uint16_t noise);
+	// draws the slot of the next wake; ms from the slot of this wake to it
+	long next();
+
+	uint8_t slot()				{ return _slot; };
+
+private:
+	uint16_t random();
+
+	uint8_t _slots;
+	uint16_t _slotMs;
+	uint16_t _random;			// xorshift, never 0
+	uint8_t _slot;
+};
+
+class WakeScheduler
+{
+public:
+	typedef void (*Task)();
+
+	WakeScheduler();
+
+	// new wake cycle: time 0, no tasks
+	void start();
+	// run 'task' 'afterMs' from now, false if the table is full
+	bool add(Task task, uint16_t afterMs);
+	// until all tasks ran, power-down in between
+	void run();
+	// power-down until 'ms' after start(), to the nearest watchdog period
+	void sleepUntil(unsigned long ms);
+	// power-down for 'ms', less by up to one watchdog period; counted in now()
+	void sleep(unsigned long ms)	{ sleepMs(ms); };
+
+	// sleepUntil() wakes in one of 'slots' slots of 'slotMs' after its 'ms'
+	void setJitter(uint8_t slots, uint16_t slotMs, uint16_t seed)	{ _jitter.begin(slots, slotMs, seed); };
+	// noise for the slots, e.g. ADC readings
+	void addEntropy(uint16_t noise)	{ _jitter.mix(noise); };
+	// ms the last sleepUntil() moved the wake against the plain interval
+	long jitterMs()				{ return _jitterMs; };
+
+	// ms since start()
+	unsigned long now();
+	// seconds since power on, without the drift of the watchdog
+	unsigned long clockSeconds();
+
+private:
+	void sleepMs(unsigned long ms);
+	void sleepPeriod();
+	unsigned long calibrate();
+
+	struct Entry {
+		Task task;
+		unsigned long at;		// due time, ms since start()
+	};
+	Entry _task[WAKE_SCHEDULER_TASKS];
+	uint8_t _count;
+	unsigned long _startMillis;
+	unsigned long _sleptUs;
+	uint16_t _wdtUs;
+	uint8_t _calibrateIn;		// start() calls until the next calibration, 0 = in this wake
+	unsigned long _clockS;		// clockSeconds() at start()
+	uint16_t _clockMs;			// and the ms on top
+	WakeJitter _jitter;
+	long _jitterMs;
+};
+
+#endif
@@ -56,9 +56,35 @@
 #define RCSwitchDisableReceiving
 #endif
 
+// Define RCSwitchTimerTransmit to send from the Timer1 compare interrupt
+// while the CPU sleeps in idle, instead of busy waiting in delayMicroseconds.
+// AVR only, Timer1 must not be used by anything else during send().
+#if defined( RCSwitchTimerTransmit ) && !defined( TCCR1B )
+#error "RCSwitchTimerTransmit needs Timer1"
+#endif
+
+// Define RCSWITCH_TX_PIN to the Arduino pin of the transmitter to write the
+// edges with FastPin, a single sbi/cbi, instead of digitalWrite(). AVR only,
+// enableTransmit() has to be called with the same pin.
+#if defined( RCSWITCH_TX_PIN )
+#include <FastGPIO.h>
+#endif
+
+// Longest packet the receiver handles. Packets longer than an unsigned long
+// are read with getReceivedBits(), e.g. multi-value frames of 64-96 bit.
+// Every bit costs 4 bytes of RAM, a smaller value can be given on the command line.
+#ifndef RCSWITCH_MAX_BITS
+#define RCSWITCH_MAX_BITS 96
+#endif
+
 // Number of maximum High/Low changes per packet.
-// We can handle up to (unsigned long) => 32 bit * 2 H/L changes per bit + 2 for sync
-#define RCSWITCH_MAX_CHANGES 67
+// 2 H/L changes per bit + 2 for sync
+#define RCSWITCH_MAX_CHANGES (RCSWITCH_MAX_BITS * 2 + 3)
+
+// Upper limit of the repeats chosen by the repeat policy, see setFrameLoss().
+#ifndef RCSWITCH_MAX_REPEAT
+#define RCSWITCH_MAX_REPEAT 20
+#endif
 
 class RCSwitch {
 
@@ -78,6 +104,7 @@ class RCSwitch {
 
     void sendTriState(const char* sCodeWord);
     void send(unsigned long code, unsigned int length);
+    void send(const uint8_t* bits, uint16_t nbits);
     void send(const char* sCodeWord);
     
     #if not defined( RCSwitchDisableReceiving )
@@ -88,6 +115,7 @@ class RCSwitch {
     void resetAvailable();
 
     unsigned long getReceivedValue();
+    const uint8_t* getReceivedBits();
     unsigned int getReceivedBitlength();
     unsigned int getReceivedDelay();
     unsigned int getReceivedProtocol();
@@ -102,6 +130,23 @@ class RCSwitch {
     void setReceiveTolerance(int nPercent);
     #endif
 
+    /**
+     * Repeat policy: instead of a fixed repeat count every send() gets the
+     * repeats needed to reach the delivery probability of its priority,
+     * given the probability that the receiver misses a single packet.
+     */
+    enum Priority {
+        PriorityLow,     // e.g. unchanged values, battery voltage
+        PriorityNormal,  // changed values
+        PriorityHigh,    // error codes
+        PriorityCount
+    };
+    void setFrameLoss(int nLoss);                                   // permille
+    void setDeliveryTarget(Priority priority, int nProbability);    // permille
+    void setPriority(Priority priority);
+    int getRepeatTransmit();
+    static int repeatsFor(int nLoss, int nProbability);
+
     struct HighLow {
         uint8_t high;
         uint8_t low;
@@ -126,6 +171,9 @@ class RCSwitch {
     char* getCodeWordC(char sFamily, int nGroup, int nDevice, bool bStatus);
     char* getCodeWordD(char group, int nDevice, bool bStatus);
     void transmit(HighLow pulses);
+    #if defined( RCSwitchTimerTransmit )
+    void transmitTimer(const uint8_t* bits, uint16_t nbits);
+    #endif
 
     #if not defined( RCSwitchDisableReceiving )
     static void handleInterrupt();
@@ -134,12 +182,17 @@ class RCSwitch {
     #endif
     int nTransmitterPin;
     int nRepeatTransmit;
+    int nFrameLoss;
+    int nDeliveryTarget[PriorityCount];
+    uint8_t nPriorityRepeat[PriorityCount];
+    void updateRepeatPolicy();
     
     Protocol protocol;
 
     #if not defined( RCSwitchDisableReceiving )
     static int nReceiveTolerance;
     static unsigned long nReceivedValue;
+    static uint8_t nReceivedBits[(RCSWITCH_MAX_BITS + 7) / 8];
     static unsigned int nReceivedBitlength;
     static unsigned int nReceivedDelay;
     static unsigned int nReceivedProtocol;
@@ -0,0 +1,69 @@
+/*
+  BatteryMonitor - supply voltage of the node, measured once per wake at most
+  see BatteryMonitor.h
+*/
+
+#include "BatteryMonitor.h"
+#include "LowPower.h"
+#include <EventLog.h>
+#include <avr/interrupt.h>
+
+// 1.1V * 1024 * 1000, calibrated bandgap of the original vccVoltage()
+#define BANDGAP_SCALE 1126400L
+
+// only wakes the CPU from ADC noise reduction, the result is read afterwards
+EMPTY_INTERRUPT(ADC_vect);
+
+BatteryMonitor::BatteryMonitor(uint8_t everyWakes, uint8_t samples)
+{
+	_everyWakes = everyWakes ? everyWakes : 1;
+	_samples = samples ? samples : 1;
+	_wakes = 0;
+	_millivolt = 0;
+}
+
+long BatteryMonitor::read()
+{
+	if (_wakes == 0) {
+		_millivolt = measure();
+		_wakes = _everyWakes;
+		EVENT(VCC, _millivolt);
+	}
+	_wakes--;
+	return _millivolt;
+}
+
+long BatteryMonitor::measure()
+{
+	long sum = 0;
+	uint16_t result;
+
+	// Read 1.1V reference against AVcc
+	#if defined(__AVR_ATmega32U4__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+	ADMUX = _BV(REFS0) | _BV(MUX4) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+	#elif defined (__AVR_ATtiny24__) || defined(__AVR_ATtiny44__) || defined(__AVR_ATtiny84__)
+	ADMUX = _BV(MUX5) | _BV(MUX0);
+	#elif defined (__AVR_ATtiny25__) || defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__)
+	ADMUX = _BV(MUX3) | _BV(MUX2);
+	#else
+	ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+	#endif
+
+	// Wait for Vref to settle: the watchdog ends this sleep, the conversion
+	// started by entering it is thrown away
+	ADCSRA &= ~_BV(ADIE);
+	LowPower.adcNoiseReduction(SLEEP_15MS, ADC_ON, TIMER2_OFF);
+
+	ADCSRA |= _BV(ADIF) | _BV(ADIE); // writing ADIF clears the flag of that conversion
+	for (uint8_t i = 0; i < _samples; i++) {
+		LowPower.adcNoiseReduction(SLEEP_FOREVER, ADC_ON, TIMER2_OFF); // the conversion starts with the sleep
+		while (bit_is_set(ADCSRA, ADSC)); // woken up by something else
+		result = ADCL;
+		result |= ADCH << 8;
+		sum += result;
+	}
+	ADCSRA &= ~_BV(ADIE);
+
+	if (sum == 0) return 0;
+	return (BANDGAP_SCALE * _samples + sum / 2) / sum; // Back-calculate AVcc in mV
+}
@@ -12,11 +12,37 @@
 // 0.1.3  2018-01-08 removed begin() + moved detection to read() function
 // 0.1.4  2018-04-03 add get-/setDisableIRQ(bool b)
 // 0.1.5  2019-01-20 fix negative temperature DHT22 - issue #120
+//        local: DHTNEWEdgeCapture, interrupt driven read
+//        local: timeouts and checksum errors go to the EventLog
 //
 // Released to the public domain
 //
 
 #include "dhtnew.h"
+#include <EventLog.h>
+
+#if defined( DHTNEWEdgeCapture )
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+// falling edges of one transfer: start of the response, start of each of
+// the 40 bits and end of the last bit
+#define DHTLIB_EDGES        42
+// Timer1 runs at clk/8
+#define DHTLIB_TICKS(us)    ((us) * (F_CPU / 1000000L) / 8)
+// bit period (50us low + high) of a "0" is ~77us, of a "1" ~120us
+#define DHTLIB_ONE_TICKS    DHTLIB_TICKS(100)
+// whole transfer incl. response ~5ms
+#define DHTLIB_READ_TICKS   DHTLIB_TICKS(8000)
+
+static volatile uint16_t edgeTime[DHTLIB_EDGES];
+static volatile uint8_t  edgeCount;
+
+static void captureEdge()
+{
+	if (edgeCount < DHTLIB_EDGES) edgeTime[edgeCount++] = TCNT1;
+}
+#endif
 
 /////////////////////////////////////////////////////
 //
@@ -55,12 +81,21 @@ int DHTNEW::_read()
 	_lastRead = millis();
 
 	// READ VALUES
+#if defined( DHTNEWEdgeCapture )
+	int rv = _readSensorEdges(); // needs the interrupts, _disableIRQ does not apply
+#else
 	if (_disableIRQ) noInterrupts();
 	int rv = _readSensor();
 	if (_disableIRQ) interrupts();
+#endif
 
 	if (rv != DHTLIB_OK)
 	{
+#if defined( DHTNEWEdgeCapture )
+		EVENT(DHT_TIMEOUT, edgeCount);
+#else
+		EVENT(DHT_TIMEOUT, 0);
+#endif
 		humidity    = DHTLIB_INVALID_VALUE;
 		temperature = DHTLIB_INVALID_VALUE;
 		return rv; // propagate error value
@@ -68,13 +103,13 @@ int DHTNEW::_read()
 
 	if (_type == 22) // DHT22, DHT33, DHT44, compatible
 	{
-		humidity =    (_bits[0] * 256 + _bits[1]) * 0.1;
-		temperature = ((_bits[2] & 0x7F) * 256 + _bits[3]) * 0.1;
+		humidity =    _bits[0] * 256 + _bits[1];
+		temperature = (_bits[2] & 0x7F) * 256 + _bits[3];
 	}
 	else // if (_type == 11)  // DHT11, DH12, compatible
 	{
-		humidity = _bits[0] + _bits[1] * 0.1;
-		temperature = _bits[2] + _bits[3] * 0.1;
+		humidity = _bits[0] * 10 + _bits[1];
+		temperature = _bits[2] * 10 + _bits[3];
 	}
 
 	if (_bits[2] & 0x80)  // negative temperature
@@ -88,6 +123,7 @@ int DHTNEW::_read()
 	uint8_t sum = _bits[0] + _bits[1] + _bits[2] + _bits[3];
 	if (_bits[4] != sum)
 	{
+		EVENT(DHT_CHECKSUM, (_bits[4] << 8) | sum);
 		return DHTLIB_ERROR_CHECKSUM;
 	}
 	return DHTLIB_OK;
@@ -161,6 +197,63 @@ int DHTNEW::_readSensor()
 
 	return DHTLIB_OK;
 }
+
+#if defined( DHTNEWEdgeCapture )
+// return values:
+// DHTLIB_OK
+// DHTLIB_ERROR_TIMEOUT
+int DHTNEW::_readSensorEdges()
+{
+	int irq = digitalPinToInterrupt(_pin); // NOT_AN_INTERRUPT is -1
+	if (irq == NOT_AN_INTERRUPT) return DHTLIB_ERROR_TIMEOUT;
+
+	// EMPTY BUFFER
+	for (uint8_t i = 0; i < 5; i++) _bits[i] = 0;
+
+	// Timer1 free running, only for the timestamps
+	TCCR1A = 0;
+	TCCR1B = _BV(CS11);
+
+	// REQUEST SAMPLE
+	pinMode(_pin, OUTPUT);
+	digitalWrite(_pin, LOW);
+	delay(_wakeupDelay);
+	attachInterrupt(irq, captureEdge, FALLING);
+	edgeCount = 0; // a flag left from our own start signal may have fired already
+	TCNT1 = 0;
+	pinMode(_pin, INPUT);
+
+	// SLEEP UNTIL ALL EDGES ARE IN or TIMEOUT
+	// the CPU is woken up by every edge and by the millis() interrupt
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	for (;;) {
+		cli();
+		if ((edgeCount >= DHTLIB_EDGES) || (TCNT1 > DHTLIB_READ_TICKS)) {
+			sei();
+			break;
+		}
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+	}
+	detachInterrupt(irq);
+	TCCR1B = 0;
+
+	if (edgeCount < DHTLIB_EDGES) return DHTLIB_ERROR_TIMEOUT;
+
+	// DECODE THE BIT PERIODS - 40 BITS => 5 BYTES
+	for (uint8_t i = 0; i < 40; i++)
+	{
+		if ((uint16_t)(edgeTime[i + 2] - edgeTime[i + 1]) > DHTLIB_ONE_TICKS)
+		{
+			_bits[i >> 3] |= 0x80 >> (i & 7);
+		}
+	}
+
+	return DHTLIB_OK;
+}
+#endif
 //
 // END OF FILE
 //
\ No newline at end of file
@@ -8,6 +8,8 @@
 // Modified by Jordan Hochenbaum
 
 #include "DallasTemperature.h"
+#include <avr/eeprom.h>
+#include <string.h>
 
 #if ARDUINO >= 100
     #include "Arduino.h"   
@@ -24,6 +26,8 @@ DallasTemperature::DallasTemperature(OneWire* _oneWire)
 {
   _wire = _oneWire;
   devices = 0;
+  readFailures = 0;
+  convResolution = 0;
   parasite = false;
   bitResolution = 9;
   waitForConversion = true;
@@ -50,11 +54,72 @@ void DallasTemperature::begin(void)
 
 	  bitResolution = max(bitResolution, getResolution(deviceAddress));
 
+      if (devices < DALLAS_CACHE_DEVICES)
+      {
+        memcpy(rom[devices], deviceAddress, 8);
+        alarm[devices][0] = scratchPad[HIGH_ALARM_TEMP];
+        alarm[devices][1] = scratchPad[LOW_ALARM_TEMP];
+      }
       devices++;
     }
   }
 }
 
+// initialise the bus from the topology cache, search only if it does not match
+bool DallasTemperature::beginCached(uint16_t eeAddress, uint8_t resolution)
+{
+  TopologyCache cache;
+
+  resolution = constrain(resolution, 9, 12);
+  eeprom_read_block(&cache, (const void*)(uintptr_t)eeAddress, sizeof(cache));
+  if (readFailures < DALLAS_SEARCH_FAILURES &&
+      cache.crc == _wire->crc8((const uint8_t*)&cache, sizeof(cache) - 1) &&
+      cache.devices > 0 && cache.devices <= DALLAS_CACHE_DEVICES &&
+      cache.resolution == resolution && _wire->reset())
+  {
+    devices = cache.devices;
+    parasite = cache.parasite;
+    bitResolution = resolution;
+    convResolution = resolution;
+    memcpy(rom, cache.rom, sizeof(rom));
+    memcpy(alarm, cache.alarm, sizeof(alarm));
+    return true;
+  }
+
+  // new, changed or missing bus or too many failed reads: full search and configure,
+  // the cache is only written if the search found another topology
+  TopologyCache found;
+
+  parasite = false;
+  readFailures = 0;
+  begin();
+  setResolution(resolution);
+  fillCache(&found);
+  if (devices > 0 && devices <= DALLAS_CACHE_DEVICES && memcmp(&found, &cache, sizeof(cache)) != 0)
+  {
+    eeprom_update_block(&found, (void*)(uintptr_t)eeAddress, sizeof(found));
+  }
+  return false;
+}
+
+// the current topology as it is stored in the cache
+void DallasTemperature::fillCache(TopologyCache* cache)
+{
+  memset(cache, 0, sizeof(*cache));
+  cache->devices = min(devices, (uint8_t)DALLAS_CACHE_DEVICES);
+  cache->resolution = bitResolution;
+  cache->parasite = parasite;
+  memcpy(cache->rom, rom, cache->devices * 8);
+  memcpy(cache->alarm, alarm, cache->devices * 2);
+  cache->crc = _wire->crc8((const uint8_t*)cache, sizeof(*cache) - 1);
+}
+
+// the next beginCached() searches the bus, nothing is written to the EEPROM
+void DallasTemperature::invalidateCache()
+{
+  readFailures = DALLAS_SEARCH_FAILURES;
+}
+
 // returns the number of devices found on the bus
 uint8_t DallasTemperature::getDeviceCount(void)
 {
@@ -73,6 +138,13 @@ bool DallasTemperature::getAddress(uint8_t* deviceAddress, uint8_t index)
 {
   uint8_t depth = 0;
 
+  // known from begin(), no search needed
+  if (index < devices && index < DALLAS_CACHE_DEVICES)
+  {
+    memcpy(deviceAddress, rom[index], 8);
+    return true;
+  }
+
   _wire->reset_search();
 
   while (depth <= index && _wire->search(deviceAddress))
@@ -171,7 +243,7 @@ void DallasTemperature::readScratchPad(uint8_t* deviceAddress, uint8_t* scratchP
 }
 
 // writes device's scratch pad
-void DallasTemperature::writeScratchPad(uint8_t* deviceAddress, const uint8_t* scratchPad)
+void DallasTemperature::writeScratchPad(uint8_t* deviceAddress, const uint8_t* scratchPad, bool copy)
 {
   _wire->reset();
   _wire->select(deviceAddress);
@@ -181,9 +253,11 @@ void DallasTemperature::writeScratchPad(uint8_t* deviceAddress, const uint8_t* s
   // DS18S20 does not use the configuration register
   if (deviceAddress[0] != DS18S20MODEL) _wire->write(scratchPad[CONFIGURATION]); // configuration
   _wire->reset();
+  if (!copy) return;
   // save the newly written values to eeprom
+  _wire->select(deviceAddress);
   _wire->write(COPYSCRATCH, parasite);
-  if (parasite) delay(10); // 10ms delay
+  delay(10); // 10ms EEPROM write, the device does not answer meanwhile
   _wire->reset();
 }
 
@@ -205,6 +279,7 @@ bool DallasTemperature::readPowerSupply(uint8_t* deviceAddress)
 void DallasTemperature::setResolution(uint8_t newResolution)
 {
   bitResolution = constrain(newResolution, 9, 12);
+  convResolution = bitResolution;
   DeviceAddress deviceAddress;
   for (int i=0; i<devices; i++)
   {
@@ -215,6 +290,8 @@ void DallasTemperature::setResolution(uint8_t newResolution)
 
 // set resolution of a device to 9, 10, 11, or 12 bits
 // if new resolution is out of range, 9 bits is used. 
+// The device EEPROM is only written if the configuration changes, after power up the
+// scratchpad holds what the EEPROM holds.
 bool DallasTemperature::setResolution(uint8_t* deviceAddress, uint8_t newResolution)
 {
   ScratchPad scratchPad;
@@ -223,6 +300,7 @@ bool DallasTemperature::setResolution(uint8_t* deviceAddress, uint8_t newResolut
     // DS18S20 has a fixed 9-bit resolution
     if (deviceAddress[0] != DS18S20MODEL)
     {
+      uint8_t configuration = scratchPad[CONFIGURATION];
       switch (newResolution)
       {
         case 12:
@@ -239,7 +317,7 @@ bool DallasTemperature::setResolution(uint8_t* deviceAddress, uint8_t newResolut
           scratchPad[CONFIGURATION] = TEMP_9_BIT;
           break;
       }
-      writeScratchPad(deviceAddress, scratchPad);
+      if (scratchPad[CONFIGURATION] != configuration) writeScratchPad(deviceAddress, scratchPad);
     }
 	return true;  // new value set
   }
@@ -315,6 +393,13 @@ bool DallasTemperature::getCheckForConversion()
 	return checkForConversion;
 }
 
+// returns true if no device on the bus converts any more, only valid
+// directly after a conversion was started (read slots return 0 while busy)
+bool DallasTemperature::isConversionComplete()
+{
+	return _wire->read_bit() == 1;
+}
+
 bool DallasTemperature::isConversionAvailable(uint8_t* deviceAddress)
 {
 	// Check if the clock has been raised indicating the conversion is complete
@@ -338,6 +423,90 @@ void DallasTemperature::requestTemperatures()
   return;
 }
 
+// sends command for all devices on the bus to perform a temperature conversion
+// and returns immediately with the time the conversion takes
+uint16_t DallasTemperature::startConversion()
+{
+  _wire->reset();
+  _wire->skip();
+  _wire->write(STARTCONVO, parasite);
+
+  return millisToWaitForConversion(bitResolution);
+}
+
+// same at another resolution, set in the scratchpads only
+uint16_t DallasTemperature::startConversion(uint8_t resolution)
+{
+  resolution = constrain(resolution, 9, 12);
+  if (resolution != convResolution)
+  {
+    ScratchPad scratchPad;
+    bool same = devices <= DALLAS_CACHE_DEVICES;
+    for (uint8_t i = 0; i < devices && i < DALLAS_CACHE_DEVICES; i++)
+    {
+      if (alarm[i][0] != alarm[0][0] || alarm[i][1] != alarm[0][1] || rom[i][0] == DS18S20MODEL) same = false;
+    }
+    scratchPad[CONFIGURATION] = TEMP_9_BIT | ((resolution - 9) << 5);
+    if (same)
+    {
+      // all devices get the same bytes, write them at once
+      _wire->reset();
+      _wire->skip();
+      _wire->write(WRITESCRATCH);
+      _wire->write(alarm[0][0]);
+      _wire->write(alarm[0][1]);
+      _wire->write(scratchPad[CONFIGURATION]);
+    }
+    else
+    {
+      for (uint8_t i = 0; i < devices && i < DALLAS_CACHE_DEVICES; i++)
+      {
+        scratchPad[HIGH_ALARM_TEMP] = alarm[i][0];
+        scratchPad[LOW_ALARM_TEMP] = alarm[i][1];
+        writeScratchPad(rom[i], scratchPad, false);
+      }
+    }
+    convResolution = resolution;
+  }
+
+  _wire->reset();
+  _wire->skip();
+  _wire->write(STARTCONVO, parasite);
+
+  return millisToWaitForConversion(resolution);
+}
+
+// returns the conversion time of the resolution (based on IC datasheet)
+uint16_t DallasTemperature::millisToWaitForConversion(uint8_t bitResolution)
+{
+  switch (bitResolution)
+  {
+    case 9:
+      return 94;
+    case 10:
+      return 188;
+    case 11:
+      return 375;
+    case 12:
+    default:
+      return 750;
+  }
+}
+
+// lowest resolution with a step of at most margin, compared in 1/160 degree
+uint8_t DallasTemperature::resolutionFor(int16_t margin)
+{
+  uint8_t resolution = 9;
+  int16_t step = 80; // 0.5 degree
+  margin *= 16;
+  while (resolution < 12 && step > margin)
+  {
+    resolution++;
+    step /= 2;
+  }
+  return resolution;
+}
+
 // sends command for one device to perform a temperature by address
 // returns FALSE if device is disconnected
 // returns TRUE  otherwise
@@ -373,22 +542,7 @@ void DallasTemperature::blockTillConversionComplete(uint8_t* bitResolution, uint
 	}
 	
   	// Wait a fix number of cycles till conversion is complete (based on IC datasheet)
-	  switch (*bitResolution)
-	  {
-	    case 9:
-	      delay(94);
-	      break;
-	    case 10:
-	      delay(188);
-	      break;
-	    case 11:
-	      delay(375);
-	      break;
-	    case 12:
-	    default:
-	      delay(750);
-	      break;
-	  }
+	delay(millisToWaitForConversion(*bitResolution));
 
 }
 
@@ -466,6 +620,47 @@ float DallasTemperature::calculateTemperature(uint8_t* deviceAddress, uint8_t* s
       return (float)(rawTemperature >> 1) - 0.25 +((float)(scratchPad[COUNT_PER_C] - scratchPad[COUNT_REMAIN]) / (float)scratchPad[COUNT_PER_C] );
       break;
   }
+  return DEVICE_DISCONNECTED; // unknown family code
+}
+
+// reads scratchpad and returns the temperature in 0.1 degrees C, truncated
+// towards zero like the float version multiplied by 10 and cast to int
+int16_t DallasTemperature::calculateTemperatureDeci(uint8_t* deviceAddress, uint8_t* scratchPad)
+{
+  int16_t rawTemperature = (((int16_t)scratchPad[TEMP_MSB]) << 8) | scratchPad[TEMP_LSB];
+  int32_t sixteenths; // 1/16 degree
+
+  switch (deviceAddress[0])
+  {
+    case MAX31850MODEL:
+      if (scratchPad[0] & 0x1) return DEVICE_DISCONNECTED_DECI;
+      sixteenths = rawTemperature;
+      break;
+    case DS18B20MODEL:
+    case DS1822MODEL:
+      // the undefined low bits of the lower resolutions are dropped
+      switch (scratchPad[CONFIGURATION])
+      {
+        case TEMP_12_BIT: sixteenths = rawTemperature; break;
+        case TEMP_11_BIT: sixteenths = rawTemperature & ~1; break;
+        case TEMP_10_BIT: sixteenths = rawTemperature & ~3; break;
+        case TEMP_9_BIT:  sixteenths = rawTemperature & ~7; break;
+        default: return DEVICE_DISCONNECTED_DECI;
+      }
+      break;
+    case DS18S20MODEL:
+    {
+      // TEMP_READ - 0.25 + (COUNT_PER_C - COUNT_REMAIN) / COUNT_PER_C, see
+      // calculateTemperature(), in 1/(4 * COUNT_PER_C) degree
+      int32_t perC = scratchPad[COUNT_PER_C];
+      if (perC == 0) return DEVICE_DISCONNECTED_DECI;
+      int32_t quarters = (int32_t)(rawTemperature >> 1) * 4 * perC - perC + 4 * (perC - scratchPad[COUNT_REMAIN]);
+      return quarters * 10 / (4 * perC);
+    }
+    default:
+      return DEVICE_DISCONNECTED_DECI;
+  }
+  return sixteenths * 10 / 16;
 }
 
 // returns temperature in degrees C or DEVICE_DISCONNECTED if the
@@ -481,9 +676,19 @@ float DallasTemperature::getTempC(uint8_t* deviceAddress)
 
   ScratchPad scratchPad;
   if (isConnected(deviceAddress, scratchPad)) return calculateTemperature(deviceAddress, scratchPad);
+  if (readFailures < DALLAS_SEARCH_FAILURES) readFailures++; // see beginCached()
   return DEVICE_DISCONNECTED;
 }
 
+// returns temperature in 0.1 degrees C or DEVICE_DISCONNECTED_DECI
+int16_t DallasTemperature::getTempDeci(uint8_t* deviceAddress)
+{
+  ScratchPad scratchPad;
+  if (isConnected(deviceAddress, scratchPad)) return calculateTemperatureDeci(deviceAddress, scratchPad);
+  if (readFailures < DALLAS_SEARCH_FAILURES) readFailures++; // see beginCached()
+  return DEVICE_DISCONNECTED_DECI;
+}
+
 // returns temperature in degrees F
 // TODO: - when getTempC returns DEVICE_DISCONNECTED 
 //        -127 gets converted to -196.6 F
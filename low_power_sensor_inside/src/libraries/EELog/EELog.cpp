@@ -0,0 +1,165 @@
+/*
+  EELog - wear levelled record log in the EEPROM
+  see EELog.h
+*/
+
+#include "EELog.h"
+#include <avr/eeprom.h>
+
+EELog::EELog(uint16_t start, uint16_t end, uint8_t size, uint8_t rewrites)
+{
+	uint16_t slots = (end + 1 - start) / (size + 2);
+	_start = start;
+	_size = size;
+	_slots = slots > EELOG_MAX_SLOTS ? EELOG_MAX_SLOTS : slots;
+	_rewrites = rewrites ? rewrites : 1;
+	_writes = _rewrites;
+	_head = 0;
+	_seq = 0;
+	_empty = true;
+	_single = false;
+}
+
+bool EELog::begin()
+{
+	_empty = true;
+	_writes = _rewrites;
+	if (!valid(0) || !search()) scan();
+	if (_empty) return false;
+	_single = !valid(_head ? _head - 1 : _slots - 1);
+	return true;
+}
+
+// the newest record in the round of slot 0, false if it is not valid
+bool EELog::search()
+{
+	// slots 0..lo are in the round of slot 0, hi is not or past the end
+	uint8_t first = sequence(0);
+	uint8_t lo = 0, hi = _slots;
+	while (hi - lo > 1) {
+		uint8_t mid = lo + (hi - lo) / 2;
+		if (inRound(mid, first)) lo = mid;
+		else hi = mid;
+	}
+	// a complete sequence number but a wrong CRC: the record itself got
+	// damaged, not only cut short
+	if (!valid(lo)) return false;
+	_head = lo;
+	_seq = sequence(lo);
+	_empty = false;
+	return true;
+}
+
+bool EELog::read(void *record)
+{
+	if (_empty) return false;
+	eeprom_read_block(record, address(_head), _size);
+	return true;
+}
+
+bool EELog::readBack(uint8_t back, void *record)
+{
+	if (_empty || back >= _slots) return false;
+	uint8_t slot = _head >= back ? _head - back : _head + _slots - back;
+	uint8_t seq = _seq >= back ? _seq - back : _seq + EELOG_ERASED - back;
+	if (sequence(slot) != seq || !valid(slot)) return false;
+	eeprom_read_block(record, address(slot), _size);
+	return true;
+}
+
+void EELog::append(const void *record)
+{
+	uint8_t slot = 0, seq = 0;
+	if (!_empty) {
+		slot = _head + 1 == _slots ? 0 : _head + 1;
+		seq = _seq + 1 == EELOG_ERASED ? 0 : _seq + 1;
+	}
+	program(slot, seq, record);
+	_single = _empty;
+	_head = slot;
+	_seq = seq;
+	_empty = false;
+	_writes = 1;
+}
+
+void EELog::write(const void *record)
+{
+	if (_empty || _single || _writes >= _rewrites) {
+		append(record);
+		return;
+	}
+	program(_head, _seq, record);
+	_writes++;
+}
+
+void EELog::program(uint8_t slot, uint8_t seq, const void *record)
+{
+	uint8_t check = 0;
+	for (uint8_t i = 0; i < _size; i++) check = crc8(check, ((const uint8_t*)record)[i]);
+	check = crc8(check, seq);
+
+	uint8_t *a = address(slot);
+	bool same = eeprom_read_byte(a + _size) == check && eeprom_read_byte(a + _size + 1) == seq;
+	for (uint8_t i = 0; same && i < _size; i++) same = eeprom_read_byte(a + i) == ((const uint8_t*)record)[i];
+	if (same) return;
+
+	// the slot is erased while the record and the CRC are programmed, the
+	// sequence number written last makes it the newest one
+	eeprom_update_byte(a + _size + 1, EELOG_ERASED);
+	eeprom_update_block(record, a, _size);
+	eeprom_update_byte(a + _size, check);
+	eeprom_update_byte(a + _size + 1, seq);
+}
+
+uint8_t EELog::sequence(uint8_t slot)
+{
+	return eeprom_read_byte(address(slot) + _size + 1);
+}
+
+bool EELog::valid(uint8_t slot)
+{
+	const uint8_t *a = address(slot);
+	uint8_t seq = eeprom_read_byte(a + _size + 1);
+	if (seq == EELOG_ERASED) return false;
+	uint8_t check = 0;
+	for (uint8_t i = 0; i < _size; i++) check = crc8(check, eeprom_read_byte(a + i));
+	check = crc8(check, seq);
+	return check == eeprom_read_byte(a + _size);
+}
+
+// slot holds the sequence number 'slot' steps after 'first'
+bool EELog::inRound(uint8_t slot, uint8_t first)
+{
+	uint8_t seq = sequence(slot);
+	if (seq == EELOG_ERASED) return false;
+	uint8_t steps = seq >= first ? seq - first : seq + EELOG_ERASED - first;
+	return steps == slot;
+}
+
+// the newest valid slot, reading all of them
+bool EELog::scan()
+{
+	for (uint8_t slot = 0; slot < _slots; slot++) {
+		if (!valid(slot)) continue;
+		uint8_t seq = sequence(slot);
+		uint8_t steps = seq >= _seq ? seq - _seq : seq + EELOG_ERASED - _seq;
+		if (_empty || (steps != 0 && steps < EELOG_ERASED / 2)) {
+			_head = slot;
+			_seq = seq;
+			_empty = false;
+		}
+	}
+	return !_empty;
+}
+
+// Dallas/Maxim CRC-8 of one more byte, the same as TelemetryFrame::crc8
+uint8_t EELog::crc8(uint8_t crc, uint8_t in)
+{
+	for (uint8_t i = 8; i; i--) {
+		uint8_t mix = (crc ^ in) & 0x01;
+		crc >>= 1;
+		if (mix) crc ^= 0x8C;
+		in >>= 1;
+	}
+	return crc;
+}
@@ -0,0 +1,75 @@
+/*
+  EventLog - binary event log for post-mortem analysis
+  see EventLog.h
+*/
+
+#include "EventLog.h"
+#include <string.h>
+
+// marks a ring that was set up by begin(), random RAM after power-on
+#define EVENTLOG_MAGIC  0x4C45
+
+EventLog eventLog __attribute__((section(".noinit")));
+
+uint8_t EventLog::begin(EELog *spill)
+{
+	// the bootloader may have cleared the flags already, 0 then
+	uint8_t flags = MCUSR;
+	MCUSR = 0;
+
+	_spill = spill;
+	_spill->begin();
+	if (_magic != EVENTLOG_MAGIC) {
+		Event last;
+		memset(_event, 0, sizeof(_event));
+		_head = 0;
+		_spilled = 0;
+		_wake = _spill->read(&last) ? last.wake + 1 : 0;
+		_magic = EVENTLOG_MAGIC;
+	}
+	_head &= EVENTLOG_EVENTS - 1;
+	_spilled &= EVENTLOG_EVENTS - 1;
+	_spilledIds = 0;
+	put(EVENT_RESET, flags);
+	return flags;
+}
+
+void EventLog::spill()
+{
+	uint8_t budget = EVENTLOG_SPILL_MAX;
+	for (; _spilled != _head; _spilled = (_spilled + 1) & (EVENTLOG_EVENTS - 1)) {
+		const Event *e = &_event[_spilled];
+		uint16_t bit = 1 << ((e->id - EVENT_FAULT) & 15);
+		if (e->id < EVENT_FAULT || (_spilledIds & bit) || !budget) continue;
+		_spill->append(e);
+		_spilledIds |= bit;
+		budget--;
+	}
+}
+
+void EventLog::dump(HardwareSerial &out)
+{
+	Event e;
+	uint8_t back = _spill->slots();
+	out.println("ev eeprom");
+	while (back--) {
+		if (_spill->readBack(back, &e)) print(out, &e);
+	}
+	out.println("ev ram");
+	uint8_t i = _head;
+	do {
+		if (_event[i].id) print(out, &_event[i]);
+		i = (i + 1) & (EVENTLOG_EVENTS - 1);
+	} while (i != _head);
+	out.println("ev end");
+}
+
+void EventLog::print(HardwareSerial &out, const Event *e)
+{
+	out.print("ev ");
+	out.print((long)e->wake);
+	out.print(" ");
+	out.print((long)e->id);
+	out.print(" ");
+	out.println((long)e->arg);
+}
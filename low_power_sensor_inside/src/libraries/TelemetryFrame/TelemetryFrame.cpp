@@ -0,0 +1,86 @@
+/*
+  TelemetryFrame - all readings of one wake cycle in one RF frame
+  see TelemetryFrame.h for the frame layout
+*/
+
+#include "TelemetryFrame.h"
+
+TelemetryFrame::TelemetryFrame(uint8_t node)
+{
+	_data.node = node & 0x0F;
+	_data.seq = 0;
+	clear();
+}
+
+void TelemetryFrame::clear()
+{
+	_data.millivolt = 0;
+	for (uint8_t i = 0; i < TELEMETRY_VALUES; i++) _data.value[i] = TELEMETRY_NO_VALUE;
+	_pending = false;
+}
+
+void TelemetryFrame::setVoltage(long millivolt)
+{
+	_data.millivolt = constrain(millivolt, TELEMETRY_MV_BASE + TELEMETRY_MV_STEP, TELEMETRY_MV_BASE + 255L * TELEMETRY_MV_STEP);
+	_pending = true;
+}
+
+void TelemetryFrame::setValue(uint8_t index, int deci)
+{
+	if (index >= TELEMETRY_VALUES) return;
+	// keep clear of the reserved values at the bottom of the range
+	_data.value[index] = constrain(deci, TELEMETRY_ERROR + 1, 2047);
+	_pending = true;
+}
+
+void TelemetryFrame::setError(uint8_t index)
+{
+	if (index >= TELEMETRY_VALUES) return;
+	_data.value[index] = TELEMETRY_ERROR;
+	_pending = true;
+}
+
+uint8_t TelemetryFrame::encode(uint8_t *buf)
+{
+	uint16_t v0 = _data.value[0] & 0x0FFF;
+	uint16_t v1 = _data.value[1] & 0x0FFF;
+
+	buf[0] = (_data.node << 4) | (_data.seq & 0x0F);
+	buf[1] = _data.millivolt ? (_data.millivolt - TELEMETRY_MV_BASE + TELEMETRY_MV_STEP / 2) / TELEMETRY_MV_STEP : 0;
+	buf[2] = v0 >> 4;
+	buf[3] = (v0 << 4) | (v1 >> 8);
+	buf[4] = v1 & 0xFF;
+	buf[5] = crc8(buf, TELEMETRY_FRAME_BYTES - 1);
+	_data.seq = (_data.seq + 1) & 0x0F;
+	return TELEMETRY_FRAME_BITS;
+}
+
+bool TelemetryFrame::decode(const uint8_t *buf, TelemetryData *data)
+{
+	if (crc8(buf, TELEMETRY_FRAME_BYTES - 1) != buf[5]) return false;
+	data->node = buf[0] >> 4;
+	data->seq = buf[0] & 0x0F;
+	data->millivolt = buf[1] ? TELEMETRY_MV_BASE + buf[1] * TELEMETRY_MV_STEP : 0;
+	uint16_t v0 = ((uint16_t)buf[2] << 4) | (buf[3] >> 4);
+	uint16_t v1 = ((uint16_t)(buf[3] & 0x0F) << 8) | buf[4];
+	// sign extend the 12 bit fields
+	data->value[0] = (int16_t)(v0 << 4) >> 4;
+	data->value[1] = (int16_t)(v1 << 4) >> 4;
+	return true;
+}
+
+// Dallas/Maxim CRC-8, the same as OneWire::crc8 without the lookup table
+uint8_t TelemetryFrame::crc8(const uint8_t *p, uint8_t len)
+{
+	uint8_t crc = 0;
+	while (len--) {
+		uint8_t in = *p++;
+		for (uint8_t i = 8; i; i--) {
+			uint8_t mix = (crc ^ in) & 0x01;
+			crc >>= 1;
+			if (mix) crc ^= 0x8C;
+			in >>= 1;
+		}
+	}
+	return crc;
+}
@@ -0,0 +1,186 @@
+/*
+  WakeScheduler - cooperative tasks of one wake cycle
+  see WakeScheduler.h
+*/
+
+#include "WakeScheduler.h"
+#include "LowPower.h"
+#include <EventLog.h>
+
+// SLEEP_15MS: 2K cycles of the nominal 128kHz watchdog oscillator
+#define WDT_NOMINAL_US  16000
+// a calibration outside of this was ended by some other interrupt
+#define WDT_MIN_US      (WDT_NOMINAL_US / 2)
+#define WDT_MAX_US      (WDT_NOMINAL_US * 3 / 2)
+// wake up from idle: 4 cycles halted, the interrupt response, the watchdog ISR and
+// the LowPower code around the sleep; timed by Timer1 in calibrate(), but counted by
+// millis() after a power-down
+#define WDT_WAKEUP_CYCLES 60
+
+// start-up time of the clock source after power-down in CK, from the CKSEL and SUT
+// bits of the low fuse; timer0 and Timer1 stand still meanwhile, idle does not stop it
+static constexpr uint32_t startupCycles(uint8_t fuse)
+{
+	return (fuse & 0x0F) < 0x04 ? 6 :                            // external clock, RC oscillators
+		(fuse & 0x0E) == 0x04 ? ((fuse & 0x20) ? 32768 : 1024) :    // low frequency crystal
+		!(fuse & 0x01) ? ((fuse & 0x20) ? 1024 : 258) :             // ceramic resonator
+		(fuse & 0x30) ? 16384 : 1024;                               // crystal
+}
+#define WDT_STARTUP_US  (startupCycles(WAKE_SCHEDULER_LOW_FUSE) / (F_CPU / 1000000UL))
+
+WakeScheduler::WakeScheduler()
+{
+	_wdtUs = WDT_NOMINAL_US;
+	_calibrateIn = 1; // the first start() calibrates
+	_clockS = 0;
+	_clockMs = 0;
+	_sleptUs = 0;
+	_startMillis = 0;
+	_count = 0;
+	_jitterMs = 0;
+}
+
+void WakeScheduler::start()
+{
+	// the wake cycle before, up to this start()
+	unsigned long ms = _clockMs + now();
+	_clockS += ms / 1000;
+	_clockMs = ms % 1000;
+
+	_count = 0;
+	_startMillis = millis();
+	_sleptUs = 0;
+	if (_calibrateIn) _calibrateIn--;
+}
+
+unsigned long WakeScheduler::now()
+{
+	return millis() - _startMillis + _sleptUs / 1000;
+}
+
+unsigned long WakeScheduler::clockSeconds()
+{
+	return _clockS + (_clockMs + now()) / 1000;
+}
+
+bool WakeScheduler::add(Task task, uint16_t afterMs)
+{
+	if (_count >= WAKE_SCHEDULER_TASKS) return false;
+	_task[_count].task = task;
+	_task[_count].at = now() + afterMs;
+	_count++;
+	return true;
+}
+
+void WakeScheduler::run()
+{
+	while (_count > 0) {
+		unsigned long t = now();
+		uint8_t next = 0;
+		for (uint8_t i = 1; i < _count; i++) {
+			if ((long)(_task[i].at - _task[next].at) < 0) next = i; // earliest, the first added on a tie
+		}
+		if ((long)(_task[next].at - t) > 0) {
+			unsigned long ms = _task[next].at - t;
+			if (ms * 1000 >= _wdtUs + WDT_STARTUP_US) sleepMs(ms);
+			else if (ms * 4000 < _wdtUs) delay(ms);
+			else sleepPeriod(); // late by less than 3/4 period, in power-down instead of active
+			continue;
+		}
+		Task task = _task[next].task;
+		_count--;
+		for (uint8_t i = next; i < _count; i++) _task[i] = _task[i + 1];
+		task(); // may add tasks
+	}
+}
+
+void WakeScheduler::sleepUntil(unsigned long ms)
+{
+	_jitterMs = _jitter.next();
+	ms += _jitterMs;
+	unsigned long t = now();
+	if ((long)(ms - t) > 0) sleepMs(ms - t + _wdtUs / 2000);
+}
+
+// the longest calibrated watchdog periods that fit with their start-up time, the rest
+// below one period is left
+void WakeScheduler::sleepMs(unsigned long ms)
+{
+	unsigned long us = ms * 1000;
+	if (!_calibrateIn && us >= WDT_MAX_US) {
+		unsigned long slept = calibrate();
+		_sleptUs += slept;
+		us -= slept;
+		_calibrateIn = WAKE_SCHEDULER_CALIBRATE;
+	}
+	for (int8_t p = SLEEP_8S; p >= SLEEP_15MS; p--) {
+		unsigned long period = ((unsigned long)_wdtUs << p) + WDT_STARTUP_US;
+		while (us >= period) {
+			LowPower.powerDown((period_t)p, ADC_OFF, BOD_OFF);
+			_sleptUs += period;
+			us -= period;
+		}
+	}
+}
+
+void WakeScheduler::sleepPeriod()
+{
+	LowPower.powerDown(SLEEP_15MS, ADC_OFF, BOD_OFF);
+	_sleptUs += _wdtUs + WDT_STARTUP_US;
+}
+
+// one SLEEP_15MS period in idle, only the watchdog wakes up: no timer0
+// interrupt, Timer1 counts without one; returns the us slept
+unsigned long WakeScheduler::calibrate()
+{
+	TCCR1A = 0;
+	TCCR1B = _BV(CS11);
+	TCNT1 = 0;
+	LowPower.idle(SLEEP_15MS, ADC_OFF, TIMER2_OFF, TIMER1_ON, TIMER0_OFF, SPI_OFF, USART0_OFF, TWI_OFF);
+	uint16_t ticks = TCNT1;
+	TCCR1B = 0;
+	_jitter.mix(ticks); // the two oscillators of this chip, the low bits differ from node to node
+	uint16_t us = ((uint32_t)ticks * 8 - WDT_WAKEUP_CYCLES) / (F_CPU / 1000000L); // clk/8
+	if (us < WDT_MIN_US || us > WDT_MAX_US) return 0;
+	_wdtUs = us;
+	EVENT(WDT_CALIBRATED, us);
+	return us;
+}
+
+WakeJitter::WakeJitter()
+{
+	begin(1, 0, 0);
+}
+
+void WakeJitter::begin(uint8_t slots, uint16_t slotMs, uint16_t seed)
+{
+	_slots = slots ? slots : 1;
+	_slotMs = slotMs;
+	_slot = 0;
+	// neighbouring ids far apart in the sequence
+	_random = (seed + 1) * 0x9E37U;
+	mix(0);
+}
+
+void WakeJitter::mix(uint16_t noise)
+{
+	_random ^= noise;
+	if (!_random) _random = 0x5EED;
+	random();
+}
+
+long WakeJitter::next()
+{
+	uint8_t last = _slot;
+	_slot = ((uint32_t)random() * _slots) >> 16;
+	return ((long)_slot - last) * _slotMs;
+}
+
+// xorshift 7, 9, 8: period 65535
+uint16_t WakeJitter::random()
+{
+	_random ^= _random << 7;
+	_random ^= _random >> 9;
+	_random ^= _random << 8;
+	return _random;
+}
@@ -40,6 +40,21 @@
     #define memcpy_P(dest, src, num) memcpy((dest), (src), (num))
 #endif
 
+#if defined( RCSwitchTimerTransmit )
+    #include <avr/interrupt.h>
+    #include <avr/sleep.h>
+#endif
+
+// level of the transmitter pin, 'pin' is ignored with RCSWITCH_TX_PIN
+static inline void txWrite(int pin, uint8_t level) {
+#if defined( RCSWITCH_TX_PIN )
+  (void)pin;
+  FastPin<RCSWITCH_TX_PIN>::write(level);
+#else
+  digitalWrite(pin, level);
+#endif
+}
+
 #ifdef ESP8266
     // interrupt handler and related code must be in RAM on ESP8266,
     // according to issue #46.
@@ -87,6 +102,7 @@ enum {
 
 #if not defined( RCSwitchDisableReceiving )
 unsigned long RCSwitch::nReceivedValue = 0;
+uint8_t RCSwitch::nReceivedBits[(RCSWITCH_MAX_BITS + 7) / 8];
 unsigned int RCSwitch::nReceivedBitlength = 0;
 unsigned int RCSwitch::nReceivedDelay = 0;
 unsigned int RCSwitch::nReceivedProtocol = 0;
@@ -101,6 +117,13 @@ unsigned int RCSwitch::timings[RCSWITCH_MAX_CHANGES];
 RCSwitch::RCSwitch() {
   this->nTransmitterPin = -1;
   this->setRepeatTransmit(10);
+  this->nFrameLoss = -1;  // no repeat policy until setFrameLoss()
+  this->nDeliveryTarget[PriorityLow] = 900;
+  this->nDeliveryTarget[PriorityNormal] = 990;
+  this->nDeliveryTarget[PriorityHigh] = 999;
+  for (uint8_t i = 0; i < PriorityCount; i++) {
+    this->nPriorityRepeat[i] = 10;
+  }
   this->setProtocol(1);
   #if not defined( RCSwitchDisableReceiving )
   this->nReceiverInterrupt = -1;
@@ -153,6 +176,80 @@ void RCSwitch::setRepeatTransmit(int nRepeatTransmit) {
   this->nRepeatTransmit = nRepeatTransmit;
 }
 
+/**
+ * Returns the repeats of the next send()
+ */
+int RCSwitch::getRepeatTransmit() {
+  return this->nRepeatTransmit;
+}
+
+/**
+ * Number of repeats needed to deliver a packet with the probability
+ * 'nProbability' if every packet is lost with the probability 'nLoss',
+ * both in permille.
+ *
+ * The receiver decodes a packet between two sync pulses, so the first
+ * transmission only delivers the sync for the second one:
+ * P = 1 - loss^(n - 1), n is the smallest one with loss^(n - 1) <= 1 - P.
+ * The powers are multiplied out in 1/1000000, without float math.
+ * The result is between 2 and RCSWITCH_MAX_REPEAT.
+ */
+int RCSwitch::repeatsFor(int nLoss, int nProbability) {
+  if (nLoss <= 0 || nProbability <= 0)
+    return 2;
+  if (nLoss >= 1000 || nProbability >= 1000)
+    return RCSWITCH_MAX_REPEAT;
+  uint32_t miss = 1000000UL;                          // loss^(n - 1)
+  uint32_t allowed = (1000UL - nProbability) * 1000;  // 1 - P
+  int n = 1;
+  while (miss > allowed && n < RCSWITCH_MAX_REPEAT) {
+    miss = miss * nLoss / 1000;
+    n++;
+  }
+  return (n < 2) ? 2 : n;
+}
+
+/**
+ * Enables the repeat policy, see setPriority()
+ *
+ * @param nLoss         probability that the receiver misses a single packet,
+ *                      0..1000 permille, measured at the receiver
+ */
+void RCSwitch::setFrameLoss(int nLoss) {
+  this->nFrameLoss = nLoss;
+  this->updateRepeatPolicy();
+}
+
+/**
+ * Sets the wanted delivery probability of a priority in permille,
+ * defaults are 900 (low), 990 (normal) and 999 (high)
+ */
+void RCSwitch::setDeliveryTarget(Priority priority, int nProbability) {
+  if (priority >= PriorityCount)
+    return;
+  this->nDeliveryTarget[priority] = nProbability;
+  this->updateRepeatPolicy();
+}
+
+/**
+ * Sets the repeats of the next send() from the repeat policy. Without
+ * setFrameLoss() the repeats of setRepeatTransmit() are kept.
+ */
+void RCSwitch::setPriority(Priority priority) {
+  if (this->nFrameLoss < 0 || priority >= PriorityCount)
+    return;
+  this->nRepeatTransmit = this->nPriorityRepeat[priority];
+}
+
+// the repeats are only calculated when the policy changes
+void RCSwitch::updateRepeatPolicy() {
+  if (this->nFrameLoss < 0)
+    return;
+  for (uint8_t i = 0; i < PriorityCount; i++) {
+    this->nPriorityRepeat[i] = repeatsFor(this->nFrameLoss, this->nDeliveryTarget[i]);
+  }
+}
+
 /**
  * Set Receiving Tolerance
  */
@@ -484,6 +581,25 @@ void RCSwitch::send(const char* sCodeWord) {
  * then the bit at position length-2, and so on, till finally the bit at position 0.
  */
 void RCSwitch::send(unsigned long code, unsigned int length) {
+  uint8_t bits[sizeof(code)];
+
+  if (length > sizeof(code) * 8)
+    length = sizeof(code) * 8;
+  // move bit length-1 to the top, then it is the first bit of the buffer
+  if (length > 0 && length < sizeof(code) * 8)
+    code <<= sizeof(code) * 8 - length;
+  for (uint8_t i = 0; i < sizeof(code); i++) {
+    bits[i] = code >> (8 * (sizeof(code) - 1 - i));
+  }
+  this->send(bits, length);
+}
+
+/**
+ * Transmit the first 'nbits' bits of the buffer 'bits'. The bits are sent
+ * MSB first, starting with bit 7 of bits[0]. Codes of any length up to the
+ * RAM of the sender, e.g. multi-value frames of 64-96 bit.
+ */
+void RCSwitch::send(const uint8_t* bits, uint16_t nbits) {
   if (this->nTransmitterPin == -1)
     return;
 
@@ -495,15 +611,19 @@ void RCSwitch::send(unsigned long code, unsigned int length) {
   }
 #endif
 
+#if defined( RCSwitchTimerTransmit )
+  this->transmitTimer(bits, nbits);
+#else
   for (int nRepeat = 0; nRepeat < nRepeatTransmit; nRepeat++) {
-    for (int i = length-1; i >= 0; i--) {
-      if (code & (1L << i))
+    for (uint16_t i = 0; i < nbits; i++) {
+      if (bits[i >> 3] & (0x80 >> (i & 7)))
         this->transmit(protocol.one);
       else
         this->transmit(protocol.zero);
     }
     this->transmit(protocol.syncFactor);
   }
+#endif
 
 #if not defined( RCSwitchDisableReceiving )
   // enable receiver again if we just disabled it
@@ -520,12 +640,112 @@ void RCSwitch::transmit(HighLow pulses) {
   uint8_t firstLogicLevel = (this->protocol.invertedSignal) ? LOW : HIGH;
   uint8_t secondLogicLevel = (this->protocol.invertedSignal) ? HIGH : LOW;
   
-  digitalWrite(this->nTransmitterPin, firstLogicLevel);
+  txWrite(this->nTransmitterPin, firstLogicLevel);
   delayMicroseconds( this->protocol.pulseLength * pulses.high);
-  digitalWrite(this->nTransmitterPin, secondLogicLevel);
+  txWrite(this->nTransmitterPin, secondLogicLevel);
   delayMicroseconds( this->protocol.pulseLength * pulses.low);
 }
 
+#if defined( RCSwitchTimerTransmit )
+/*
+ * Transmission driven by the Timer1 compare A interrupt (CTC mode, clk/8).
+ * The pulse table holds the high and low time of "0", "1" and sync in timer
+ * ticks, the ISR only sets the pin and loads the next time into OCR1A. Every
+ * edge is written with the same interrupt latency, so the pulse lengths are
+ * exact to the timer tick.
+ */
+enum { txZero, txOne, txSync };
+
+static uint16_t txTable[3][2];      // [zero, one, sync][high, low] in timer ticks
+static const uint8_t* txBits;
+static uint16_t txNbits;
+static uint16_t txIndex;            // bit being sent, txNbits is the sync
+static int txRepeat;
+static uint8_t txPin;
+static uint8_t txFirstLevel;
+static bool txHighPart;
+static volatile bool txBusy;
+
+static inline uint8_t txSymbol() {
+  if (txIndex == txNbits)
+    return txSync;
+  return (txBits[txIndex >> 3] & (0x80 >> (txIndex & 7))) ? txOne : txZero;
+}
+
+static uint16_t txTicks(unsigned long us) {
+  unsigned long ticks = us * (F_CPU / 100000L) / 80; // clk/8
+  if (ticks < 1)
+    ticks = 1;
+  return (ticks > 65535) ? 65535 : ticks;
+}
+
+ISR(TIMER1_COMPA_vect) {
+  if (txHighPart) {
+    txWrite(txPin, !txFirstLevel);
+    OCR1A = txTable[txSymbol()][1] - 1;
+    txHighPart = false;
+    return;
+  }
+  // low part done, next symbol
+  if (++txIndex > txNbits) {
+    txIndex = 0;
+    if (--txRepeat == 0) {
+      TCCR1B = 0;
+      TIMSK1 &= ~_BV(OCIE1A);
+      txBusy = false;
+      return;
+    }
+  }
+  txWrite(txPin, txFirstLevel);
+  OCR1A = txTable[txSymbol()][0] - 1;
+  txHighPart = true;
+}
+
+/**
+ * Send 'nRepeatTransmit' times from the Timer1 interrupt, the CPU sleeps in
+ * idle in between. Returns when the last sync is done.
+ */
+void RCSwitch::transmitTimer(const uint8_t* bits, uint16_t nbits) {
+  const HighLow* pulses[3] = { &protocol.zero, &protocol.one, &protocol.syncFactor };
+
+  if (this->nRepeatTransmit <= 0)
+    return;
+  for (uint8_t i = 0; i < 3; i++) {
+    txTable[i][0] = txTicks((unsigned long)protocol.pulseLength * pulses[i]->high);
+    txTable[i][1] = txTicks((unsigned long)protocol.pulseLength * pulses[i]->low);
+  }
+  txBits = bits;
+  txNbits = nbits;
+  txRepeat = this->nRepeatTransmit;
+  txPin = this->nTransmitterPin;
+  txFirstLevel = (this->protocol.invertedSignal) ? LOW : HIGH;
+
+  // start as if a low part just ended, so that the first edge is written
+  // by the ISR as well
+  txIndex = 0xFFFF;
+  txHighPart = false;
+  txBusy = true;
+  TCCR1B = 0;
+  TCCR1A = 0;
+  TCNT1 = 0;
+  OCR1A = 0;
+  TIFR1 = _BV(OCF1A);
+  TIMSK1 |= _BV(OCIE1A);
+  TCCR1B = _BV(WGM12) | _BV(CS11);
+
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  while (txBusy) {
+    cli();
+    if (txBusy) {
+      sleep_enable();
+      sei();
+      sleep_cpu();
+      sleep_disable();
+    }
+    sei();
+  }
+}
+#endif
 
 #if not defined( RCSwitchDisableReceiving )
 /**
@@ -559,17 +779,29 @@ void RCSwitch::disableReceive() {
 }
 
 bool RCSwitch::available() {
-  return RCSwitch::nReceivedValue != 0;
+  return RCSwitch::nReceivedBitlength != 0;
 }
 
 void RCSwitch::resetAvailable() {
   RCSwitch::nReceivedValue = 0;
+  RCSwitch::nReceivedBitlength = 0;
 }
 
+/**
+ * The last 32 bits of the received code, for longer codes see getReceivedBits().
+ */
 unsigned long RCSwitch::getReceivedValue() {
   return RCSwitch::nReceivedValue;
 }
 
+/**
+ * All getReceivedBitlength() bits of the received code, MSB first starting
+ * with bit 7 of the first byte, the same layout send(const uint8_t*, uint16_t) takes.
+ */
+const uint8_t* RCSwitch::getReceivedBits() {
+  return RCSwitch::nReceivedBits;
+}
+
 unsigned int RCSwitch::getReceivedBitlength() {
   return RCSwitch::nReceivedBitlength;
 }
@@ -603,6 +835,8 @@ bool RECEIVE_ATTR RCSwitch::receiveProtocol(const int p, unsigned int changeCoun
 #endif
 
     unsigned long code = 0;
+    uint8_t bits[sizeof(RCSwitch::nReceivedBits)];
+    unsigned int nbits = 0;
     //Assuming the longer pulse length is the pulse captured in timings[0]
     const unsigned int syncLengthInPulses =  ((pro.syncFactor.low) > (pro.syncFactor.high)) ? (pro.syncFactor.low) : (pro.syncFactor.high);
     const unsigned int delay = RCSwitch::timings[0] / syncLengthInPulses;
@@ -627,7 +861,12 @@ bool RECEIVE_ATTR RCSwitch::receiveProtocol(const int p, unsigned int changeCoun
      */
     const unsigned int firstDataTiming = (pro.invertedSignal) ? (2) : (1);
 
+    memset(bits, 0, sizeof(bits));
     for (unsigned int i = firstDataTiming; i < changeCount - 1; i += 2) {
+        if (nbits >= RCSWITCH_MAX_BITS) {
+            // longer than the buffers, handleInterrupt() passes up to RCSWITCH_MAX_CHANGES
+            return false;
+        }
         code <<= 1;
         if (diff(RCSwitch::timings[i], delay * pro.zero.high) < delayTolerance &&
             diff(RCSwitch::timings[i + 1], delay * pro.zero.low) < delayTolerance) {
@@ -636,15 +875,18 @@ bool RECEIVE_ATTR RCSwitch::receiveProtocol(const int p, unsigned int changeCoun
                    diff(RCSwitch::timings[i + 1], delay * pro.one.low) < delayTolerance) {
             // one
             code |= 1;
+            bits[nbits >> 3] |= 0x80 >> (nbits & 7);
         } else {
             // Failed
             return false;
         }
+        nbits++;
     }
 
     if (changeCount > 7) {    // ignore very short transmissions: no device sends them, so this must be noise
         RCSwitch::nReceivedValue = code;
-        RCSwitch::nReceivedBitlength = (changeCount - 1) / 2;
+        memcpy(RCSwitch::nReceivedBits, bits, sizeof(bits));
+        RCSwitch::nReceivedBitlength = nbits;
         RCSwitch::nReceivedDelay = delay;
         RCSwitch::nReceivedProtocol = p;
         return true;